@@ -29,6 +29,15 @@ int main()
 	}
 	printf("Approach row-access(): elapsed time = %.3f s\n", timer.elapsed<float>());
 
+	// histogram micro-benchmark: single-threaded vs parallel with interleaved count banks
+	timer.restart();
+	std::vector<int> hist1 = ucas::histogram(img);
+	printf("Histogram (ucas): elapsed time = %.3f s\n", timer.elapsed<float>());
+
+	timer.restart();
+	std::vector<int> hist2 = aia::histogram(img);
+	printf("Histogram (aia): elapsed time = %.3f s, same result = %s\n", timer.elapsed<float>(), hist1 == hist2 ? "yes" : "no");
+
 	aia::imshow("Display image", img);
 
 	return EXIT_SUCCESS;
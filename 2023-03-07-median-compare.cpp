@@ -10,32 +10,10 @@
 
 // <>
 
+// median filter with the constant-time histogram method, see aia::medianHistogram
 cv::Mat medianCustom(const cv::Mat& img, int k)
 {
-	int h = k / 2;
-	int m = (k * k) / 2;
-
-	std::vector<unsigned char> buffer(k * k);
-	cv::Mat out_img(img.rows, img.cols, CV_8U, cv::Scalar(0));
-
-	for (int i = h; i < img.rows - h; i++)
-	{
-		unsigned char* out_iRow = out_img.ptr(i);
-		for (int j = h; j < img.cols - h; j++)
-		{
-			int idx = 0;
-			for (int ii = i - h; ii < i + h; ii++)
-			{
-				const unsigned char* buffer_iRow = img.ptr(ii);
-				for (int jj = j - h; jj < j + h; jj++)
-					buffer[idx++] = buffer_iRow[jj];
-			}
-			std::nth_element(buffer.begin(), buffer.begin() + m, buffer.end());
-			out_iRow[j] = buffer[m];
-		}
-	}
-
-	return out_img;
+	return aia::medianHistogram(img, k);
 }
 
 int main()
@@ -43,16 +21,48 @@ int main()
 	cv::Mat img = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/rice.png", cv::IMREAD_GRAYSCALE);
 	aia::imshow("Original image", img, true, 2.0);
 
-	ucas::Timer timer;
-	cv::Mat res1 = medianCustom(img, 5);
-	printf("Median (custom): elapsed time = %.3f s\n", timer.elapsed<float>());
-	aia::imshow("Median-filtered (custom)", res1, true, 2.0);
+	// compare against OpenCV for all kernel sizes up to 31x31
+	cv::Mat res1, res2;
+	for (int k = 3; k <= 31; k += 2)
+	{
+		ucas::Timer timer;
+		res1 = medianCustom(img, k);
+		float elapsed_custom = timer.elapsed<float>();
 
-	timer.restart();
-	cv::Mat res2;
-	cv::medianBlur(img, res2, 5);
-	printf("Median (OpenCV): elapsed time = %.3f s\n", timer.elapsed<float>());
+		timer.restart();
+		cv::medianBlur(img, res2, k);
+		float elapsed_opencv = timer.elapsed<float>();
+
+		printf("k = %2d: custom = %.3f s, OpenCV = %.3f s, different pixels = %d\n",
+			k, elapsed_custom, elapsed_opencv, cv::countNonZero(res1 != res2));
+	}
+	aia::imshow("Median-filtered (custom)", res1, true, 2.0);
 	aia::imshow("Median-filtered (OpenCV)", res2, true, 2.0);
 
+	// small kernels on grayscale and color frames: aia::median uses the sorting networks,
+	// which are fast enough to be timed over several runs
+	cv::Mat img_color = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/girl.png");
+	cv::Mat frames[] = { img, img_color };
+	const char* frame_names[] = { "gray", "BGR" };
+	const int n_runs = 10;
+	for (int f = 0; f < 2; f++)
+		for (int k = 3; k <= 7; k += 2)
+		{
+			ucas::Timer timer;
+			for (int r = 0; r < n_runs; r++)
+				res1 = aia::median(frames[f], k);
+			float elapsed_aia = timer.elapsed<float>() / n_runs;
+
+			timer.restart();
+			for (int r = 0; r < n_runs; r++)
+				cv::medianBlur(frames[f], res2, k);
+			float elapsed_opencv = timer.elapsed<float>() / n_runs;
+
+			// compare all channels
+			cv::Mat different = res1 != res2;
+			printf("%4s, k = %d: aia::median = %.4f s, OpenCV = %.4f s, different values = %d\n",
+				frame_names[f], k, elapsed_aia, elapsed_opencv, cv::countNonZero(different.reshape(1)));
+		}
+
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
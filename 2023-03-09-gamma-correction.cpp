@@ -16,17 +16,11 @@ cv::Mat img;
 
 void gammaCorrection(int pos, void* userdata)
 {
-	cv::Mat out_img(img.rows, img.cols, CV_8U);
+	cv::Mat out_img;
 	
+	// gamma correction is evaluated on the 256 gray levels only, then applied with a table lookup
 	float gamma = gamma_x10 / 10.0f;
-	float c = std::pow(255, 1 - gamma);
-	for (int i = 0; i < img.rows; i++)
-	{
-		unsigned char* iThRowIn = img.ptr(i);
-		unsigned char* iThRowOut = out_img.ptr(i);
-		for (int j = 0; j < img.cols; j++)
-			iThRowOut[j] = c * std::pow(iThRowIn[j], gamma);
-	}
+	aia::applyLUT(img, aia::gammaLUT(CV_8U, gamma), out_img);
 
 	cv::imshow(winname, out_img);
 }
@@ -27,12 +27,8 @@ int main()
 	img /= (maxV - minV);
 	img *= 255;*/
 
-	for (int i = 0; i < img.rows; i++)
-	{
-		unsigned char* iThRow = img.ptr(i);
-		for (int j = 0; j < img.cols; j++)
-			iThRow[j] = ((iThRow[j]-minV)/float(maxV-minV))*255;
-	}
+	// linear stretching [minV, maxV] --> [0, 255] with a lookup table
+	aia::applyLUT(img, aia::piecewiseLinearLUT(CV_8U, { cv::Point2f(minV, 0), cv::Point2f(maxV, 255) }), img);
 
 	// this is the buil-in OpenCV function that implements the opearation above
 	//cv::normalize(img, img, 0, 255, cv::NORM_MINMAX);
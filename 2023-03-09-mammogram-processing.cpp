@@ -17,19 +17,20 @@ int main()
 
 	printf("bitdepth = %d\n", aia::bitdepth(mammo.depth()));
 
+	// optional 9x9 median denoising, directly on the 16-bit data (without losing dynamic range):
+	// disabled by default, since it changes the processed (and saved) image
+	bool denoise = false;
+	if (denoise)
+		mammo = aia::median(mammo, 9);
+
+	// logarithmic transform followed by inversion: both are folded
+	// into a single lookup table, which also gives the final histogram
 	int L = std::pow(2, 14);
-	float c = (L - 1) / std::log10(L);
-
-	for (int i = 0; i < mammo.rows; i++)
-	{
-		unsigned short* iThRow = mammo.ptr<unsigned short>(i);
-		for (int j = 0; j < mammo.cols; j++)
-			iThRow[j] = c * std::log10(1 + iThRow[j]);
-	}
-
-	mammo = L - 1 - mammo;
+	std::vector<int> mammo_hist;
+	aia::PointPipeline(CV_16U, L).log().invert().apply(mammo, mammo, mammo_hist);
 
 	aia::imshow("Mammogram", mammo, true, 0.5);
+	aia::imshow("Mammogram histogram", aia::imhist(mammo_hist));
 	cv::imwrite(std::string(EXAMPLE_IMAGES_PATH) + "/raw_mammogram_processed.tif", mammo);
 
 	return EXIT_SUCCESS;
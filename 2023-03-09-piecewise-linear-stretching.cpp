@@ -18,7 +18,7 @@ std::vector<int> img_hist;
 
 void piecewiseLinearStretching(int pos, void* userdata)
 {
-	cv::Mat out_img(img.rows, img.cols, CV_8U);
+	cv::Mat out_img;
 	/*printf("perc1 = %d\n", perc1);
 	printf("perc2 = %d\n", perc2);*/
 
@@ -53,20 +53,8 @@ void piecewiseLinearStretching(int pos, void* userdata)
 
 	int c = 0.05 * 255;
 	int d = 0.95 * 255;
-	for (int i = 0; i < img.rows; i++)
-	{
-		unsigned char* iThRowIn = img.ptr(i);
-		unsigned char* iThRowOut = out_img.ptr(i);
-		for (int j = 0; j < img.cols; j++)
-		{
-			if (iThRowIn[j] < perc1_value)
-				iThRowOut[j] = iThRowIn[j] * c / perc1_value;
-			else if (iThRowIn[j] > perc2_value)
-				iThRowOut[j] = (iThRowIn[j] - perc2_value) * (255 - d) / (255 - perc2_value) + d;
-			else
-				iThRowOut[j] = (iThRowIn[j] - perc1_value) * (d - c) / (perc2_value - perc1_value) + c;
-		}
-	}
+	std::vector<cv::Point2f> points = { cv::Point2f(0, 0), cv::Point2f(perc1_value, c), cv::Point2f(perc2_value, d), cv::Point2f(255, 255) };
+	aia::applyLUT(img, aia::piecewiseLinearLUT(CV_8U, points), out_img);
 
 	cv::imshow(winname, out_img);
 }
@@ -80,7 +68,7 @@ int main()
 	cv::createTrackbar("Perc 1", winname, &perc1, 100, piecewiseLinearStretching);
 	cv::createTrackbar("Perc 2", winname, &perc2, 100, piecewiseLinearStretching);
 
-	img_hist = ucas::histogram(img);
+	img_hist = aia::histogram(img);
 
 	piecewiseLinearStretching(0, 0);
 	cv::waitKey(0);
@@ -16,9 +16,9 @@ int main()
 	std::vector <cv::Mat> img_chans(3);
 	cv::split(img, img_chans);
 
-	std::vector<int> img_histB = ucas::histogram(img_chans[0]); // luminance channel
-	std::vector<int> img_histG = ucas::histogram(img_chans[1]); // luminance channel
-	std::vector<int> img_histR = ucas::histogram(img_chans[2]); // luminance channel
+	std::vector<int> img_histB = aia::histogram(img_chans[0]); // luminance channel
+	std::vector<int> img_histG = aia::histogram(img_chans[1]); // luminance channel
+	std::vector<int> img_histR = aia::histogram(img_chans[2]); // luminance channel
 	aia::imshow("Original image", img);
 	
 	std::vector<unsigned char> hist_eq_LUT_B(256);
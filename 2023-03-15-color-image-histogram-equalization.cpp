@@ -19,7 +19,7 @@ int main()
 	std::vector <cv::Mat> img_Lab_chans(3);
 	cv::split(img_Lab, img_Lab_chans);
 
-	std::vector<int> img_hist = ucas::histogram(img_Lab_chans[2]); // luminance channel
+	std::vector<int> img_hist = aia::histogram(img_Lab_chans[2]); // luminance channel
 	aia::imshow("Original image", img);
 	aia::imshow("Original histogram", ucas::imhist(img_Lab_chans[0]));
 
@@ -90,7 +90,7 @@ int main()
 	cv::createTrackbar("Perc 1", winname, &perc1, 100, piecewiseLinearStretching);
 	cv::createTrackbar("Perc 2", winname, &perc2, 100, piecewiseLinearStretching);
 
-	img_hist = ucas::histogram(img_Lab_chans[0]); // luminance channel
+	img_hist = aia::histogram(img_Lab_chans[0]); // luminance channel
 
 	piecewiseLinearStretching(0, 0);
 	cv::waitKey(0);
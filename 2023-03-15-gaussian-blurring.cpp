@@ -11,6 +11,7 @@
 // <>
 
 int sigma = 1;
+int recursive = 1;		// 1 = recursive (IIR) Gaussian, whose cost does not depend on sigma, 0 = FIR
 std::string winname = "Gaussian smoothing";
 cv::Mat img;
 
@@ -21,7 +22,10 @@ void GaussianBlurring(int pos, void* userdata)
 
 	cv::Mat out_img(img.rows, img.cols, CV_8U);
 
-	cv::GaussianBlur(img, out_img, cv::Size(0, 0), sigma, sigma);
+	if (recursive)
+		out_img = aia::gaussianRecursive(img, sigma, sigma);
+	else
+		cv::GaussianBlur(img, out_img, cv::Size(0, 0), sigma, sigma);
 
 	cv::imshow(winname, out_img);
 }
@@ -30,11 +34,27 @@ int main()
 {
 	img = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/girl.png");
 
+	// accuracy and speed of the recursive Gaussian w.r.t. the FIR one
+	// (same border handling, so that differences are only due to the IIR approximation)
+	for (int s : {1, 3, 10, 30, 100})
+	{
+		ucas::Timer timer;
+		cv::Mat fir;
+		cv::GaussianBlur(img, fir, cv::Size(0, 0), s, s, cv::BORDER_REPLICATE);
+		float fir_ms = timer.elapsed<float>() * 1000;
+		timer.restart();
+		cv::Mat iir = aia::gaussianRecursive(img, s, s);
+		float iir_ms = timer.elapsed<float>() * 1000;
+		printf("sigma = %3d: FIR %7.1f ms, IIR %5.1f ms, max abs difference %.0f, PSNR %.1f dB\n",
+			s, fir_ms, iir_ms, cv::norm(fir, iir, cv::NORM_INF), cv::PSNR(fir, iir));
+	}
+
 	cv::namedWindow(winname, cv::WINDOW_AUTOSIZE);
 	cv::createTrackbar("Sigma", winname, &sigma, 100, GaussianBlurring);
+	cv::createTrackbar("IIR", winname, &recursive, 1, GaussianBlurring);
 
 	GaussianBlurring(0, 0);
 	cv::waitKey(0);
 
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
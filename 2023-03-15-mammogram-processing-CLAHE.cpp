@@ -3,6 +3,9 @@
 #include "ucasConfig.h"
 #include <opencv2/imgproc/imgproc.hpp>
 
+// include my project functions
+#include "functions.h"
+
 namespace
 {
 	cv::Mat img;
@@ -10,6 +13,21 @@ namespace
 	int clip_limit = 10;
 	int tile_size = 4;
 
+	// the source image never changes, so its channels and colorspace conversions
+	// are computed only once (see cachePlanes) and reused by every callback
+	std::vector<cv::Mat> img_BGR;		// B, G, R channels
+	std::vector<cv::Mat> img_Lab;		// L, a, b channels
+	cv::Mat img_value;					// V = max(B, G, R), i.e. the V channel of HSV
+
+	void cachePlanes()
+	{
+		cv::split(img, img_BGR);
+		cv::Mat img_Lab_merged;
+		cv::cvtColor(img, img_Lab_merged, cv::COLOR_BGR2Lab);
+		cv::split(img_Lab_merged, img_Lab);
+		img_value = aia::colorValue(img);
+	}
+
 	void CLAHECallback(int pos, void* userdata)
 	{
 		cv::imshow(win_name, img);
@@ -17,39 +35,33 @@ namespace
 		if (tile_size < 1)
 			return;
 
-		cv::Mat transformed_img;
-		std::vector<cv::Mat> transformed_img_channels;
+		std::vector<cv::Mat> transformed_img_channels(3);
 		cv::Mat out;
 		cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(clip_limit, cv::Size(tile_size, tile_size));
 
 		// BGR-based
-		// channels split
-		cv::split(img, transformed_img_channels);
 		// 3x per-channel CLAHE
-		clahe->apply(transformed_img_channels[0], transformed_img_channels[0]);
-		clahe->apply(transformed_img_channels[1], transformed_img_channels[1]);
-		clahe->apply(transformed_img_channels[2], transformed_img_channels[2]);
+		clahe->apply(img_BGR[0], transformed_img_channels[0]);
+		clahe->apply(img_BGR[1], transformed_img_channels[1]);
+		clahe->apply(img_BGR[2], transformed_img_channels[2]);
 		// channels merge
 		cv::merge(transformed_img_channels, out);
 		cv::imshow("Result (BGR)", out);
 
-		// HSV-based
-		// color space selection BGR --> HSV
-		cv::cvtColor(img, transformed_img, cv::COLOR_BGR2HSV);
-		cv::split(transformed_img, transformed_img_channels);
-		// channel selection and CLAHE
-		clahe->apply(transformed_img_channels[2], transformed_img_channels[2]);
-		// HSV --> BGR color space restoration
-		cv::merge(transformed_img_channels, out);
-		cv::cvtColor(out, out, cv::COLOR_HSV2BGR);
+		// HSV-based (luminance only)
+		// CLAHE on the V channel, then B, G and R are scaled by the gain V'/V:
+		// same as replacing V in HSV space, but without HSV <--> BGR conversions
+		cv::Mat value_eq;
+		clahe->apply(img_value, value_eq);
+		out = aia::applyValueGain(img, img_value, value_eq);
 		cv::imshow("Result (HSV)", out);
 
 		// Lab-based
-		// color space selection BGR --> Lab
-		cv::cvtColor(img, transformed_img, cv::COLOR_BGR2Lab);
-		cv::split(transformed_img, transformed_img_channels);
 		// channel selection and CLAHE
-		clahe->apply(transformed_img_channels[0], transformed_img_channels[0]);
+		// (into a new L plane: the cached one must not be overwritten)
+		cv::Mat L_eq;
+		clahe->apply(img_Lab[0], L_eq);
+		transformed_img_channels = { L_eq, img_Lab[1], img_Lab[2] };
 		// Lab --> BGR color space restoration
 		cv::merge(transformed_img_channels, out);
 		cv::cvtColor(out, out, cv::COLOR_Lab2BGR);
@@ -61,7 +73,34 @@ namespace
 
 int main()
 {
+	// native 16-bit CLAHE on the raw (14-bit) mammogram at full resolution
+	cv::Mat raw = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/raw_mammogram.tif", cv::IMREAD_UNCHANGED);
+	if (raw.data)
+	{
+		ucas::Timer timer;
+		cv::Mat raw_eq = aia::clahe(raw, 4, cv::Size(8, 8), 16384, 4096);
+		printf("16-bit CLAHE on %d x %d raw mammogram: %.1f ms\n", raw.cols, raw.rows, timer.elapsed<float>() * 1000);
+
+		// statistical comparison with OpenCV's CLAHE on the 8-bit version of the same image
+		cv::Mat raw8, raw8_eq;
+		raw.convertTo(raw8, CV_8U, 255.0 / 16383);
+		timer.restart();
+		cv::createCLAHE(4, cv::Size(8, 8))->apply(raw8, raw8_eq);
+		printf("8-bit OpenCV CLAHE: %.1f ms\n", timer.elapsed<float>() * 1000);
+		cv::Mat raw_eq8;
+		raw_eq.convertTo(raw_eq8, CV_8U, 255.0 / 16383);
+		cv::Scalar mean_own, stdev_own, mean_ocv, stdev_ocv;
+		cv::meanStdDev(raw_eq8, mean_own, stdev_own);
+		cv::meanStdDev(raw8_eq, mean_ocv, stdev_ocv);
+		printf("mean / stdev (8-bit scale): 16-bit CLAHE %.1f / %.1f, OpenCV %.1f / %.1f, mean abs difference %.2f\n",
+			mean_own[0], stdev_own[0], mean_ocv[0], stdev_ocv[0], cv::norm(raw_eq8, raw8_eq, cv::NORM_L1) / raw8.total());
+
+		cv::resize(raw_eq, raw_eq, cv::Size(0, 0), 0.2, 0.2);
+		cv::imshow("Raw mammogram (16-bit CLAHE)", raw_eq * 4);
+	}
+
 	img = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/pro_mammogram_small.tif");
+	cachePlanes();
 
 	cv::namedWindow(win_name);
 	cv::createTrackbar("clip_limit", win_name, &clip_limit, 100, CLAHECallback);
@@ -12,6 +12,7 @@
 
 int k = 1;
 int salt_pepper_perc = 0;
+int adaptive = 0;
 std::string winname = "Denoising salt-and-pepper";
 cv::Mat img;
 
@@ -36,7 +37,18 @@ void denoiseSaltPepper(int pos, void* userdata)
 	if (k % 2 == 1)
 	{
 		cv::Mat img_denoised;
-		cv::medianBlur(img_corrupted, img_denoised, k);
+		if (adaptive && k >= 3)
+		{
+			// only corrupted pixels are processed, with windows growing up to k x k
+			aia::AdaptiveMedianStats stats;
+			img_denoised = aia::medianAdaptive(img_corrupted, k, aia::IMPULSE_EXTREMES, 0, &stats);
+			printf("impulse candidates = %d (%.1f%%)\n", stats.candidates, 100.0 * stats.candidates / img.total());
+			for (int i = 0; i < stats.processed.size(); i++)
+				printf("\t%2dx%2d window: %d pixels\n", 3 + 2 * i, 3 + 2 * i, stats.processed[i]);
+			printf("\tunresolved: %d pixels\n", stats.unresolved);
+		}
+		else
+			img_denoised = aia::median(img_corrupted, k);
 		cv::imshow("Denoised", img_denoised);
 	}
 }
@@ -49,6 +61,7 @@ int main()
 	cv::namedWindow(winname, cv::WINDOW_AUTOSIZE);
 	cv::createTrackbar("saltpepper perc", winname, &salt_pepper_perc, 100, denoiseSaltPepper);
 	cv::createTrackbar("median size", winname, &k, 50, denoiseSaltPepper);
+	cv::createTrackbar("adaptive", winname, &adaptive, 1, denoiseSaltPepper);
 
 	denoiseSaltPepper(0, 0);
 	cv::waitKey(0);
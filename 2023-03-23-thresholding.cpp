@@ -47,7 +47,7 @@ int main()
 		cv::IMREAD_GRAYSCALE);
 	cv::resize(img, img, cv::Size(0, 0), 2, 2);
 
-	hist = ucas::histogram(img);
+	hist = aia::histogram(img);
 
 	cv::namedWindow(winname, cv::WINDOW_AUTOSIZE | cv::WINDOW_GUI_EXPANDED);
 	cv::createTrackbar("block size", winname, &block_size, 100, adaptiveThresholding);
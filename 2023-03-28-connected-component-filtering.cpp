@@ -15,7 +15,7 @@ int main()
 	cv::Mat img = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/tools.png",
 		cv::IMREAD_GRAYSCALE);
 
-	std::vector<int> hist = ucas::histogram(img);
+	std::vector<int> hist = aia::histogram(img);
 
 	int T_triangle = ucas::getTriangleAutoThreshold(hist);
 	cv::Mat img_thresholded;
@@ -43,7 +43,7 @@ cv::Mat frameProcessor(const cv::Mat& img)
 	std::vector <cv::Mat> hsv_chans(3);
 	cv::split(img_HSV, hsv_chans);
 
-	std::vector<int> V_hist = ucas::histogram(hsv_chans[2]);
+	std::vector<int> V_hist = aia::histogram(hsv_chans[2]);
 	int T_otsu = ucas::getOtsuAutoThreshold(V_hist);
 	cv::Mat V_binarized;
 	cv::threshold(hsv_chans[2], V_binarized, T_otsu, 255, cv::THRESH_BINARY);
@@ -19,7 +19,7 @@ int main()
 
 	cv::Mat img = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/text.png", cv::IMREAD_GRAYSCALE);
 
-	std::vector<int> hist = ucas::histogram(img);
+	std::vector<int> hist = aia::histogram(img);
 	int T = ucas::getOtsuAutoThreshold(hist);
 	cv::threshold(img, img, T, 255, cv::THRESH_BINARY_INV);
 
@@ -34,21 +34,29 @@ int main()
 	img.copyTo(marker, marker_mask);
 	aia::imshow("Marker", marker);
 	
+	// animate = true shows the iterative conditional dilations, otherwise the reconstruction
+	// is computed at once with the FIFO algorithm (linear in the number of pixels)
+	bool animate = false;
 	cv::Mat mask = img;
-	cv::Mat marker_prev;
-	do
+	if (animate)
 	{
-		marker_prev = marker.clone();
+		cv::Mat marker_prev;
+		do
+		{
+			marker_prev = marker.clone();
 
-		cv::morphologyEx(marker, marker, cv::MORPH_DILATE,
-			cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3)));
+			cv::morphologyEx(marker, marker, cv::MORPH_DILATE,
+				cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3)));
 
-		marker = marker & mask;
+			marker = marker & mask;
 
-		cv::imshow("Reconstruction in progress", marker);
-		cv::waitKey(10);
+			cv::imshow("Reconstruction in progress", marker);
+			cv::waitKey(10);
 
-	} while (cv::countNonZero(marker-marker_prev));
+		} while (cv::countNonZero(marker-marker_prev));
+	}
+	else
+		marker = aia::reconstructBinary(marker, mask);
 
 	aia::imshow("Filling result", 255-marker);
 
@@ -73,21 +73,41 @@ int main()
 	thinning_SEs.push_back(rotate90(thinning_SE_45, 2));
 	thinning_SEs.push_back(rotate90(thinning_SE_45, 3));
 
+	// animate = true shows the thinning steps on 8-bit images, otherwise the image is packed at 1 bit
+	// per pixel and thinned with word-parallel hit-or-miss transforms and popcount convergence checks
+	bool animate = false;
 	cv::Mat current = img.clone();
-	cv::Mat previous;
-	do 
+	if (animate)
 	{
-		previous = current.clone();
-		for (auto SE : thinning_SEs)
+		cv::Mat previous;
+		do 
 		{
-			cv::Mat hitmiss_result;
-			cv::morphologyEx(current, hitmiss_result, cv::MORPH_HITMISS, SE);
-			current -= hitmiss_result;
-			cv::imshow("Thinning in progress", current);
-			cv::waitKey(10);
+			previous = current.clone();
+			for (auto SE : thinning_SEs)
+			{
+				cv::Mat hitmiss_result;
+				cv::morphologyEx(current, hitmiss_result, cv::MORPH_HITMISS, SE);
+				current -= hitmiss_result;
+				cv::imshow("Thinning in progress", current);
+				cv::waitKey(10);
+			}
+		} 
+		while (cv::countNonZero(previous-current));
+	}
+	else
+	{
+		ucas::Timer timer;
+		aia::BinaryImage skeleton(img), previous;
+		do
+		{
+			previous = skeleton;
+			for (auto SE : thinning_SEs)
+				skeleton -= skeleton.hitOrMiss(SE);
 		}
-	} 
-	while (cv::countNonZero(previous-current));
+		while (skeleton.countDifferent(previous));
+		current = skeleton.toMat();
+		printf("bit-packed thinning: %.1f ms, %lld skeleton pixels\n", timer.elapsed<float>() * 1000, skeleton.count());
+	}
 
 
 	aia::imshow("Skeletonization result", current);
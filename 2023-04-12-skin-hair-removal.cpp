@@ -2,6 +2,9 @@
 #include "aiaConfig.h"
 #include "ucasConfig.h"
 
+// include my project functions
+#include "functions.h"
+
 int main()
 {
 	
@@ -10,34 +13,59 @@ int main()
 
 	aia::imshow("Original image", img, true, 0.5f);
 
-	cv::Mat marker;
-	cv::morphologyEx(img, marker, cv::MORPH_OPEN,
-		cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(41, 41)));
+	// large disk: periodic line decomposition, whose cost does not depend on the disk size
+	cv::Mat marker = aia::morphologyEllipse(img, cv::MORPH_OPEN, cv::Size(41, 41));
+
+	// benchmark = true also computes the opening with the exact disk and compares the two
+	bool benchmark = false;
+	if (benchmark)
+	{
+		ucas::Timer timer;
+		cv::Mat marker_lines = aia::morphologyEllipse(img, cv::MORPH_OPEN, cv::Size(41, 41));
+		float lines_ms = timer.elapsed<float>() * 1000;
+		timer.restart();
+		cv::Mat marker_exact;
+		cv::morphologyEx(img, marker_exact, cv::MORPH_OPEN,
+			cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(41, 41)));
+		float exact_ms = timer.elapsed<float>() * 1000;
+		cv::Mat marker_diff;
+		cv::absdiff(marker_lines, marker_exact, marker_diff);
+		printf("41x41 disk opening: %.1f ms (exact disk %.1f ms), mean absolute difference %.2f\n",
+			lines_ms, exact_ms, cv::mean(marker_diff)[0]);
+	}
 	aia::imshow("Marker", marker, true, 0.5f);
 
+	// animate = true shows the iterative geodesic dilations, otherwise the reconstruction is computed
+	// at once with the hybrid algorithm (the 3x3 ellipse is a cross, i.e. 4-connectivity)
+	bool animate = false;
 	cv::Mat mask = img;
-	cv::Mat marker_prev;
-	std::vector<cv::Mat> marker_channels(3);
-	std::vector<cv::Mat> marker_prev_channels(3);
-	do
+	if (animate)
 	{
-		marker_prev = marker.clone();
+		cv::Mat marker_prev;
+		std::vector<cv::Mat> marker_channels(3);
+		std::vector<cv::Mat> marker_prev_channels(3);
+		do
+		{
+			marker_prev = marker.clone();
 
-		cv::split(marker_prev, marker_prev_channels);
+			cv::split(marker_prev, marker_prev_channels);
 
-		cv::morphologyEx(marker, marker, cv::MORPH_DILATE,
-			cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3)));
+			cv::morphologyEx(marker, marker, cv::MORPH_DILATE,
+				cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3)));
 
-		cv::min(marker, mask, marker);
+			cv::min(marker, mask, marker);
 
-		cv::split(marker, marker_channels);
+			cv::split(marker, marker_channels);
 
-		aia::imshow("Reconstruction in progress", marker, false, 0.5f);
-		cv::waitKey(10);
+			aia::imshow("Reconstruction in progress", marker, false, 0.5f);
+			cv::waitKey(10);
 
-	} while (cv::countNonZero(marker_channels[0] - marker_prev_channels[0]) ||
-		     cv::countNonZero(marker_channels[1] - marker_prev_channels[1]) ||
-		     cv::countNonZero(marker_channels[2] - marker_prev_channels[2]));
+		} while (cv::countNonZero(marker_channels[0] - marker_prev_channels[0]) ||
+			     cv::countNonZero(marker_channels[1] - marker_prev_channels[1]) ||
+			     cv::countNonZero(marker_channels[2] - marker_prev_channels[2]));
+	}
+	else
+		marker = aia::reconstructGrayscale(marker, mask, 4);
 
 	aia::imshow("Recontruction result", marker, true, 0.5f);
 	aia::imshow("Stars result", img-marker, true, 0.5f);
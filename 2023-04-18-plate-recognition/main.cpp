@@ -3,6 +3,9 @@
 #include "ucasConfig.h"
 #include "functions.h"
 
+// include the shared project functions (van Herk/Gil-Werman morphology)
+#include "../functions.h"
+
 // plate detection parameters
 cv::Size tophat_kernel = cv::Size(33, 11);
 int min_area = 1000;
@@ -34,9 +37,8 @@ cv::Mat frameProcessor(const cv::Mat& frame)
 	frame_gray(crop_rect).setTo(cv::Scalar(255));
 
 	// plate enhancement with grayscale morphological tophat
-	cv::Mat tophat;
-	cv::morphologyEx(frame_gray, tophat, cv::MORPH_TOPHAT,
-		cv::getStructuringElement(cv::MORPH_RECT, tophat_kernel));
+	// (rectangular SE: van Herk/Gil-Werman, whose cost does not depend on the SE size)
+	cv::Mat tophat = aia::morphologyRect(frame_gray, cv::MORPH_TOPHAT, tophat_kernel);
 	if (visual_debug)
 		aia::imshow("Image enhancement with tophat", tophat, false);
 
@@ -133,9 +135,7 @@ cv::Mat frameProcessor(const cv::Mat& frame)
 		// character enhancement with morphological bottom hat
 		// WARNING: not necessary if the plate is "clean", meaning that there are
 		// no shadows (this requires a perfect [for us] cloudy day)
-		cv::Mat bottom_hat;
-		cv::morphologyEx(corrected_plate_img, bottom_hat, cv::MORPH_BLACKHAT,
-			cv::getStructuringElement(cv::MORPH_RECT, bottomhat_kernel));
+		cv::Mat bottom_hat = aia::morphologyRect(corrected_plate_img, cv::MORPH_BLACKHAT, bottomhat_kernel);
 		if (visual_debug)
 			aia::imshow("Enhanced characters", bottom_hat, false, 3.0f);
 
@@ -17,21 +17,58 @@ cv::Mat img;
 
 void CannyEdgeDetection(int pos, void* userdata)
 {
-	cv::Mat img_smoothed;
-	cv::GaussianBlur(img, img_smoothed, cv::Size(0, 0), sigma_x10 / 10.0f, sigma_x10 / 10.0f);
-
-	cv::Mat img_edges;
-	cv::Canny(img_smoothed, img_edges, T_low, 3 * T_low);
+	// smoothing, gradient, non-maximum suppression and hysteresis in parallel row bands
+	cv::Mat img_edges = aia::canny(img, T_low, 3 * T_low, sigma_x10 / 10.0);
 
 	cv::imshow(winname, img_edges);
 }
 
+// GaussianBlur + cv::Canny vs. aia::canny on a given image (the result must be identical
+// to the single-threaded one and to cv::Canny on the same smoothed image)
+void CannyBenchmark(const std::string & name, const cv::Mat & frame, double sigma, double T)
+{
+	ucas::Timer timer;
+	cv::Mat smoothed, edges_opencv;
+	cv::GaussianBlur(frame, smoothed, cv::Size(0, 0), sigma, sigma, cv::BORDER_REPLICATE);
+	cv::Canny(smoothed, edges_opencv, T, 3 * T);
+	float opencv_ms = timer.elapsed<float>() * 1000;
+
+	timer.restart();
+	cv::Mat edges = aia::canny(frame, T, 3 * T, sigma);
+	float fused_ms = timer.elapsed<float>() * 1000;
+
+	int n_threads = cv::getNumThreads();
+	cv::setNumThreads(1);
+	timer.restart();
+	cv::Mat edges_serial = aia::canny(frame, T, 3 * T, sigma);
+	float serial_ms = timer.elapsed<float>() * 1000;
+	cv::setNumThreads(n_threads);
+
+	cv::Mat edges_presmoothed = aia::canny(smoothed, T, 3 * T);
+	printf("%s (%dx%d): GaussianBlur + cv::Canny %.1f ms, aia::canny %.1f ms (1 thread: %.1f ms), "
+		"%d pixels differ from 1 thread, %d from cv::Canny on the same smoothed image\n",
+		name.c_str(), frame.cols, frame.rows, opencv_ms, fused_ms, serial_ms,
+		cv::countNonZero(edges != edges_serial), cv::countNonZero(edges_presmoothed != edges_opencv));
+}
+
 int main()
 {
 	img = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/girl.png",
 		cv::IMREAD_GRAYSCALE);
 	//cv::resize(img, img, cv::Size(0, 0), 0.5, 0.5);
 
+	// benchmark = true compares aia::canny with GaussianBlur + cv::Canny before the UI appears
+	bool benchmark = false;
+	if (benchmark)
+	{
+		cv::Mat frame_4k;
+		cv::resize(img, frame_4k, cv::Size(3840, 2160));
+		CannyBenchmark("4K frame", frame_4k, 2.0, 20);
+		cv::Mat retina = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/retina_lowcontrast.bmp", cv::IMREAD_GRAYSCALE);
+		if (retina.data)
+			CannyBenchmark("retina", retina, 2.0, 10);
+	}
+
 	cv::namedWindow(winname, cv::WINDOW_AUTOSIZE | cv::WINDOW_GUI_EXPANDED);
 	cv::createTrackbar("sigma_x10", winname, &sigma_x10, 100, CannyEdgeDetection);
 	cv::createTrackbar("T_low", winname, &T_low, 200, CannyEdgeDetection);
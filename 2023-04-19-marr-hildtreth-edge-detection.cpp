@@ -1,6 +1,7 @@
 // include aia and ucas utility functions
 #include "aiaConfig.h"
 #include "ucasConfig.h"
+#include "functions.h"
 
 // include opencv
 #include <opencv2/core/core.hpp>
@@ -16,12 +17,14 @@ namespace
 	// LoG parameters
 	int LoG_sigmaX10 = 1;
 	int LoG_thresh = 50;
+	int LoG_dog = 0;		// 1 = difference of Gaussians instead of Gaussian + Laplacian
 
 	// other stuff
 	std::string win_name_1 = "Gradient-based edge detection";
 	std::string win_name_2 = "LoG edge detection";
 	std::string win_name_3 = "Canny edge detection";
 	cv::Mat img;
+	aia::GaussianScaleSpace scale_space;	// smoothed images, shared by both detectors and cached across callbacks
 
 	void gradientEdgeDetectionCallback(int pos, void* userdata)
 	{
@@ -29,37 +32,23 @@ namespace
 			return;
 
 		// preprocessing: gaussian smoothing
-		cv::Mat img_preprocessed;
-		cv::GaussianBlur(img, img_preprocessed, cv::Size(0, 0), sigmaX10 / 10.0);
-
-		// sobel derivatives
-		cv::Mat dx, dy;
-		cv::Sobel(img_preprocessed, dx, CV_32F, 1, 0);
-		cv::Sobel(img_preprocessed, dy, CV_32F, 0, 1);
-		cv::Mat mag;
-		cv::magnitude(dx, dy, mag);
-		cv::normalize(mag, mag, 0, 255, cv::NORM_MINMAX);
-		mag.convertTo(mag, CV_8U);
+		cv::Mat img_preprocessed = scale_space.blur(sigmaX10 / 10.0);
 
-		double minV, maxV;
-		cv::minMaxLoc(mag, &minV, &maxV);
-		int T = ucas::round((thresh / 100.0) * maxV);
-		cv::threshold(mag, mag, T, 255, cv::THRESH_BINARY);
+		// sobel derivatives, magnitude normalized in [0, 255] and thresholding in one pass
+		cv::Mat edges = aia::sobelEdges(img_preprocessed, (thresh / 100.0) * 255);
 
-		cv::imshow(win_name_1, mag);
+		cv::imshow(win_name_1, edges);
 	}
 
-	void LoGDetectionCallback(int pos, void* userdata)
+	// second-derivative response: Gaussian + 3x3 Laplacian, or difference of Gaussians
+	cv::Mat LoGResponse(double sigma, bool dog)
 	{
-		if (LoG_sigmaX10 == 0)
-			return;
+		// difference of adjacent levels of the (float) Gaussian scale space
+		if (dog)
+			return scale_space.differenceOfGaussians(sigma);
 
 		// gaussian convolution
-		cv::Mat img_gaussian;
-		int n = ucas::round(6 * LoG_sigmaX10 / 10.0);
-		if (n % 2 == 0)
-			n++;
-		cv::GaussianBlur(img, img_gaussian, cv::Size(n, n), LoG_sigmaX10 / 10.0);
+		cv::Mat img_gaussian = scale_space.blur(sigma);
 
 		// laplacian convolution
 		cv::Mat laplKernel = (cv::Mat_<float>(3, 3) <<
@@ -68,48 +57,21 @@ namespace
 			1, 1, 1);
 		cv::Mat img_LoG;
 		cv::filter2D(img_gaussian, img_LoG, CV_32F, laplKernel);
+		return img_LoG;
+	}
 
-		// allocate result image
-		cv::Mat result(img.rows, img.cols, CV_8U, cv::Scalar(0));
+	void LoGDetectionCallback(int pos, void* userdata)
+	{
+		if (LoG_sigmaX10 == 0)
+			return;
+
+		cv::Mat img_LoG = LoGResponse(LoG_sigmaX10 / 10.0, LoG_dog != 0);
 
 		// thresholded zero-crossing
 		double minV, maxV;
 		cv::minMaxLoc(cv::abs(img_LoG), &minV, &maxV);
 		double T = (LoG_thresh / 100.0) * maxV;
-		for (int y = 1; y < img_LoG.rows - 1; y++)
-		{
-			float* prevRow = img_LoG.ptr<float>(y - 1);
-			float* currRow = img_LoG.ptr<float>(y);
-			float* nextRow = img_LoG.ptr<float>(y + 1);
-			unsigned char* resultRow = result.ptr<unsigned char>(y);
-			for (int x = 1; x < img_LoG.cols - 1; x++)
-			{
-				float N = prevRow[x];
-				float NE = prevRow[x + 1];
-				float E = currRow[x + 1];
-				float SE = nextRow[x + 1];
-				float S = nextRow[x];
-				float SW = nextRow[x - 1];
-				float W = currRow[x - 1];
-				float NW = prevRow[x - 1];
-				if (N < 0 && S > 0 && std::abs(N - S) >= T)
-					resultRow[x] = 255;
-				else if (N > 0 && S < 0 && std::abs(N - S) >= T)
-					resultRow[x] = 255;
-				else if (W > 0 && E < 0 && std::abs(W - E) >= T)
-					resultRow[x] = 255;
-				else if (W < 0 && E > 0 && std::abs(W - E) >= T)
-					resultRow[x] = 255;
-				else if (NE > 0 && SW < 0 && std::abs(NE - SW) >= T)
-					resultRow[x] = 255;
-				else if (NE < 0 && SW > 0 && std::abs(NE - SW) >= T)
-					resultRow[x] = 255;
-				else if (NW > 0 && SE < 0 && std::abs(NW - SE) >= T)
-					resultRow[x] = 255;
-				else if (NW < 0 && SE > 0 && std::abs(NW - SE) >= T)
-					resultRow[x] = 255;
-			}
-		}
+		cv::Mat result = aia::zeroCrossings(img_LoG, T);
 
 		cv::imshow(win_name_2, result);
 	}
@@ -120,7 +82,8 @@ int main()
 	try
 	{
 		img = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/rice.png", cv::IMREAD_GRAYSCALE);
-		
+		scale_space.setImage(img);
+
 		// create the UIs
 		cv::namedWindow(win_name_1);
 		cv::createTrackbar("sigma_x10", win_name_1, &sigmaX10, 100, gradientEdgeDetectionCallback);
@@ -128,6 +91,7 @@ int main()
 		cv::namedWindow(win_name_2);
 		cv::createTrackbar("sigma_x10", win_name_2, &LoG_sigmaX10, 100, LoGDetectionCallback);
 		cv::createTrackbar("thresh", win_name_2, &LoG_thresh, 100, LoGDetectionCallback);
+		cv::createTrackbar("DoG", win_name_2, &LoG_dog, 1, LoGDetectionCallback);
 
 		// start the UIs
 		gradientEdgeDetectionCallback(0, 0);
@@ -135,6 +99,7 @@ int main()
 
 		// waits for user to press a button and exit from the app
 		cv::waitKey(0);
+		printf("scale-space cache: %d hits, %d misses, %.1f MB\n", scale_space.hits(), scale_space.misses(), scale_space.memory() / 1048576.0);
 	}
 	catch (aia::error& ex)
 	{
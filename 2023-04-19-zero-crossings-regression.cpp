@@ -0,0 +1,108 @@
+// include aia and ucas utility functions
+#include "aiaConfig.h"
+#include "ucasConfig.h"
+#include "functions.h"
+
+// include opencv
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+// regression test of the vectorized zero-crossing detector (aia::zeroCrossings) against the scalar one
+// on LoG and DoG responses: returns EXIT_FAILURE if any pixel differs
+
+namespace
+{
+	// reference (scalar) thresholded zero-crossing, that aia::zeroCrossings must reproduce
+	cv::Mat zeroCrossingsScalar(const cv::Mat & img_LoG, float T)
+	{
+		cv::Mat result(img_LoG.rows, img_LoG.cols, CV_8U, cv::Scalar(0));
+		for (int y = 1; y < img_LoG.rows - 1; y++)
+		{
+			const float* prevRow = img_LoG.ptr<float>(y - 1);
+			const float* currRow = img_LoG.ptr<float>(y);
+			const float* nextRow = img_LoG.ptr<float>(y + 1);
+			unsigned char* resultRow = result.ptr<unsigned char>(y);
+			for (int x = 1; x < img_LoG.cols - 1; x++)
+			{
+				float N = prevRow[x];
+				float NE = prevRow[x + 1];
+				float E = currRow[x + 1];
+				float SE = nextRow[x + 1];
+				float S = nextRow[x];
+				float SW = nextRow[x - 1];
+				float W = currRow[x - 1];
+				float NW = prevRow[x - 1];
+				if (N < 0 && S > 0 && std::abs(N - S) >= T)
+					resultRow[x] = 255;
+				else if (N > 0 && S < 0 && std::abs(N - S) >= T)
+					resultRow[x] = 255;
+				else if (W > 0 && E < 0 && std::abs(W - E) >= T)
+					resultRow[x] = 255;
+				else if (W < 0 && E > 0 && std::abs(W - E) >= T)
+					resultRow[x] = 255;
+				else if (NE > 0 && SW < 0 && std::abs(NE - SW) >= T)
+					resultRow[x] = 255;
+				else if (NE < 0 && SW > 0 && std::abs(NE - SW) >= T)
+					resultRow[x] = 255;
+				else if (NW > 0 && SE < 0 && std::abs(NW - SE) >= T)
+					resultRow[x] = 255;
+				else if (NW < 0 && SE > 0 && std::abs(NW - SE) >= T)
+					resultRow[x] = 255;
+			}
+		}
+		return result;
+	}
+
+}
+
+int main()
+{
+	try
+	{
+		cv::Mat img = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/rice.png", cv::IMREAD_GRAYSCALE);
+		if (!img.data)
+			throw ucas::Error("cannot load image");
+		aia::GaussianScaleSpace scale_space;
+		scale_space.setImage(img);
+
+		cv::Mat laplKernel = (cv::Mat_<float>(3, 3) <<
+			1, 1, 1,
+			1, -8, 1,
+			1, 1, 1);
+
+		int failures = 0;
+		for (int dog = 0; dog <= 1; dog++)
+			for (double sigma : {1.0, 2.0, 4.0})
+			{
+				// Gaussian + 3x3 Laplacian, or difference of Gaussians
+				cv::Mat img_LoG;
+				if (dog)
+					img_LoG = scale_space.differenceOfGaussians(sigma);
+				else
+					cv::filter2D(scale_space.blur(sigma), img_LoG, CV_32F, laplKernel);
+
+				double minV, maxV;
+				cv::minMaxLoc(cv::abs(img_LoG), &minV, &maxV);
+				for (int t : {0, 10, 50})
+				{
+					float T = float((t / 100.0) * maxV);
+					int mismatches = cv::countNonZero(aia::zeroCrossings(img_LoG, T) != zeroCrossingsScalar(img_LoG, T));
+					printf("%s, sigma = %.0f, thresh = %d: %d mismatches\n", dog ? "DoG" : "LoG", sigma, t, mismatches);
+					if (mismatches)
+						failures++;
+				}
+			}
+
+		return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+	catch (aia::error& ex)
+	{
+		std::cout << "EXCEPTION thrown by " << ex.getSource() << "source :\n\t|=> " << ex.what() << std::endl;
+	}
+	catch (ucas::Error& ex)
+	{
+		std::cout << "EXCEPTION thrown by unknown source :\n\t|=> " << ex.what() << std::endl;
+	}
+
+	return EXIT_FAILURE;
+}
@@ -7,21 +7,13 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+// include my project functions
+#include "functions.h"
+
 cv::Mat localVariance(const cv::Mat img, int k)
 {
-	cv::Mat img_sq;
-	img.convertTo(img_sq, CV_32F);
-	cv::pow(img_sq, 2, img_sq);
-
-	cv::Mat img_sq_avg;
-	cv::boxFilter(img_sq, img_sq_avg, CV_32F, cv::Size(k, k));
-
-	cv::Mat img_avg;
-	cv::boxFilter(img, img_avg, CV_32F, cv::Size(k, k));
-	cv::Mat img_avg_sq;
-	cv::pow(img_avg, 2, img_avg_sq);
-
-	cv::Mat img_variance = img_sq_avg - img_avg_sq;
+	// integral images of the image and of its square: O(1) per pixel for any k
+	cv::Mat img_variance = aia::LocalStatistics(img).variance(k);
 
 	cv::normalize(img_variance, img_variance, 0, 255, cv::NORM_MINMAX);
 	img_variance.convertTo(img_variance, CV_8U);
@@ -2,6 +2,9 @@
 #include "aiaConfig.h"
 #include "ucasConfig.h"
 
+// include my project functions
+#include "functions.h"
+
 // include opencv
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -25,9 +28,7 @@ int main()
 	cv::threshold(img_bin, img_bin, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
 	aia::imshow("Binarized image", img_bin);
 
-	cv::Mat img_bin_closed;
-	cv::morphologyEx(img_bin, img_bin_closed, cv::MORPH_CLOSE,
-		cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(11, 11)));
+	cv::Mat img_bin_closed = aia::morphologyEllipse(img_bin, cv::MORPH_CLOSE, cv::Size(11, 11));
 	aia::imshow("Closed binary image", img_bin_closed);
 
 	cv::Mat dist_transform;
@@ -55,9 +56,8 @@ int main()
 		cv::drawContours(markers, internal_markers_objs, k, cv::Scalar(k + 1), cv::FILLED);
 
 	// external markers
-	cv::Mat img_bin_dilated;
-	cv::dilate(img_bin, img_bin_dilated,
-		cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(65, 65))); 
+	// large disk: periodic line decomposition, whose cost does not depend on the disk size
+	cv::Mat img_bin_dilated = aia::morphologyEllipse(img_bin, cv::MORPH_DILATE, cv::Size(65, 65));
 	aia::imshow("Dilated binarized image", img_bin_dilated);
 	std::vector< std::vector<cv::Point> > external_markers_objs;
 	cv::findContours(img_bin_dilated, external_markers_objs, cv::RETR_LIST, cv::CHAIN_APPROX_NONE);
@@ -39,7 +39,7 @@ int main()
 	cv::cvtColor(img, img_gray, cv::COLOR_BGR2GRAY);
 
 	// binarize with Triangle method
-	std::vector<int> histo = ucas::histogram(img_gray);
+	std::vector<int> histo = aia::histogram(img_gray);
 	cv::threshold(img_gray, img_gray, ucas::getTriangleAutoThreshold(histo), 255, cv::THRESH_BINARY);
 
 	// remove small structures
@@ -0,0 +1,4506 @@
+#include <iostream>
+#include <bitset>
+#include "functions.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+using namespace aia;
+
+// helpers that are not visible outside this file
+namespace
+{
+	// clamp 'i' within [0, n-1] (= border replication)
+	inline int clampIndex(int i, int n)
+	{
+		return i < 0 ? 0 : (i >= n ? n - 1 : i);
+	}
+
+	// median filtering of rows [y0, y1) of 'img' with the two-level histogram method
+	void medianHistogramBand(const cv::Mat & img, cv::Mat & out_img, int k, int y0, int y1)
+	{
+		int r = k / 2;
+		int t = (k * k) / 2;	// rank of the median within the sorted window
+		int cn = img.channels();
+		int n = img.cols + 2 * r;	// number of columns, including the replicated ones
+
+		// column of 'img' each (padded) column refers to
+		std::vector<int> x_ofs(n);
+		for (int x = 0; x < n; x++)
+			x_ofs[x] = clampIndex(x - r, img.cols) * cn;
+
+		// column histograms: 16 coarse bins and 256 fine bins for each column and channel
+		std::vector<unsigned short> col_coarse(n * cn * 16, 0);
+		std::vector<unsigned short> col_fine(n * cn * 256, 0);
+
+		// add (or remove) one image row to (from) all column histograms
+		auto updateColumns = [&](int y, int sign)
+		{
+			const unsigned char* yRow = img.ptr(clampIndex(y, img.rows));
+			for (int x = 0; x < n; x++)
+				for (int c = 0; c < cn; c++)
+				{
+					unsigned char v = yRow[x_ofs[x] + c];
+					col_coarse[(x * cn + c) * 16 + (v >> 4)] += sign;
+					col_fine[(x * cn + c) * 256 + v] += sign;
+				}
+		};
+
+		// initialize column histograms with the k rows centered on the first row of the band
+		for (int y = y0 - r; y <= y0 + r; y++)
+			updateColumns(y, 1);
+
+		// window histogram (k * k counts: 32-bit, unlike the column histograms that count k pixels)
+		int H_coarse[16];
+		int H_fine[256];
+		int last_update[16];	// window position each fine bucket was last updated for
+
+		for (int y = y0; y < y1; y++)
+		{
+			// slide column histograms down by one row
+			if (y > y0)
+			{
+				updateColumns(y - r - 1, -1);
+				updateColumns(y + r, 1);
+			}
+
+			unsigned char* out_yRow = out_img.ptr(y);
+			for (int c = 0; c < cn; c++)
+			{
+				// coarse window histogram of the first k columns,
+				// fine buckets will be built the first time they are needed
+				std::fill(H_coarse, H_coarse + 16, 0);
+				for (int x = 0; x < k; x++)
+					for (int b = 0; b < 16; b++)
+						H_coarse[b] += col_coarse[(x * cn + c) * 16 + b];
+				std::fill(last_update, last_update + 16, -k);
+
+				for (int x = 0; x < img.cols; x++)
+				{
+					// slide window right by one column: coarse histogram is always kept up to date
+					if (x > 0)
+					{
+						const unsigned short* col_in = &col_coarse[((x + k - 1) * cn + c) * 16];
+						const unsigned short* col_out = &col_coarse[((x - 1) * cn + c) * 16];
+						for (int b = 0; b < 16; b++)
+							H_coarse[b] += col_in[b] - col_out[b];
+					}
+
+					// find the coarse bucket the median falls into
+					int sum = 0;
+					int b = 0;
+					while (sum + H_coarse[b] <= t)
+						sum += H_coarse[b++];
+
+					// bring the fine bucket up to date with the current window position
+					int* H_bucket = H_fine + b * 16;
+					if (x - last_update[b] >= k)
+					{
+						// no overlap with the previous update: rebuild it from scratch
+						std::fill(H_bucket, H_bucket + 16, 0);
+						for (int xx = x; xx < x + k; xx++)
+						{
+							const unsigned short* col = &col_fine[(xx * cn + c) * 256 + b * 16];
+							for (int i = 0; i < 16; i++)
+								H_bucket[i] += col[i];
+						}
+					}
+					else
+					{
+						for (int xx = last_update[b]; xx < x; xx++)
+						{
+							const unsigned short* col_in = &col_fine[((xx + k) * cn + c) * 256 + b * 16];
+							const unsigned short* col_out = &col_fine[(xx * cn + c) * 256 + b * 16];
+							for (int i = 0; i < 16; i++)
+								H_bucket[i] += col_in[i] - col_out[i];
+						}
+					}
+					last_update[b] = x;
+
+					// find the median within the fine bucket
+					int i = 0;
+					while (sum + H_bucket[i] <= t)
+						sum += H_bucket[i++];
+
+					out_yRow[x * cn + c] = b * 16 + i;
+				}
+			}
+		}
+	}
+
+	// median filtering of rows [y0, y1) of the 16-bit image 'img' with a sliding two-level histogram
+	void medianHistogram16Band(const cv::Mat & img, cv::Mat & out_img, int k, int y0, int y1)
+	{
+		int r = k / 2;
+		int t = (k * k) / 2;	// rank of the median within the sorted window
+		int cn = img.channels();
+
+		std::vector<int> H_fine(65536);
+		std::vector<int> H_coarse(256);
+
+		for (int c = 0; c < cn; c++)
+		{
+			std::fill(H_fine.begin(), H_fine.end(), 0);
+			std::fill(H_coarse.begin(), H_coarse.end(), 0);
+			int med = 0;	// current median
+			int lt = 0;		// number of window values < med
+
+			// add (sign = 1) or remove (sign = -1) pixel (y, x) to / from the window histogram
+			auto update = [&](int y, int x, int sign)
+			{
+				unsigned short v = img.ptr<unsigned short>(clampIndex(y, img.rows))[clampIndex(x, img.cols) * cn + c];
+				H_fine[v] += sign;
+				H_coarse[v >> 8] += sign;
+				if (v < med)
+					lt += sign;
+			};
+			auto updateRow = [&](int y, int x, int sign)
+			{
+				for (int xx = x - r; xx <= x + r; xx++)
+					update(y, xx, sign);
+			};
+			auto updateColumn = [&](int y, int x, int sign)
+			{
+				for (int yy = y - r; yy <= y + r; yy++)
+					update(yy, x, sign);
+			};
+
+			// move the median to the t-th smallest window value, skipping
+			// whole coarse bins when they are entirely below / above it
+			auto findMedian = [&]()
+			{
+				while (lt > t)
+				{
+					int b = (med - 1) >> 8;
+					if ((med & 255) == 0 && lt - H_coarse[b] > t)
+					{
+						lt -= H_coarse[b];
+						med -= 256;
+					}
+					else
+						lt -= H_fine[--med];
+				}
+				while (lt + H_fine[med] <= t)
+				{
+					int b = med >> 8;
+					if ((med & 255) == 0 && lt + H_coarse[b] <= t)
+					{
+						lt += H_coarse[b];
+						med += 256;
+					}
+					else
+						lt += H_fine[med++];
+				}
+				return med;
+			};
+
+			// first window of the band
+			for (int yy = y0 - r; yy <= y0 + r; yy++)
+				updateRow(yy, 0, 1);
+
+			// serpentine scan: left to right on even rows, right to left on odd rows
+			for (int y = y0; y < y1; y++)
+			{
+				unsigned short* out_yRow = out_img.ptr<unsigned short>(y);
+				bool forward = (y - y0) % 2 == 0;
+				int x = forward ? 0 : img.cols - 1;
+				if (y > y0)
+				{
+					updateRow(y - r - 1, x, -1);
+					updateRow(y + r, x, 1);
+				}
+				for (int i = 0; i < img.cols; i++)
+				{
+					if (i > 0)
+					{
+						if (forward)
+						{
+							updateColumn(y, x - r, -1);
+							updateColumn(y, x + r + 1, 1);
+							x++;
+						}
+						else
+						{
+							updateColumn(y, x + r, -1);
+							updateColumn(y, x - r - 1, 1);
+							x--;
+						}
+					}
+					out_yRow[x * cn + c] = findMedian();
+				}
+			}
+		}
+	}
+
+	// replace the impulse candidate at (y, x) with the median of the clean pixels of
+	// the smallest window that contains some, and return the window size index (-1 = none)
+	int resolveImpulse(const cv::Mat & img, const cv::Mat & candidates, int y, int x, int k_max,
+		std::vector<unsigned char> & clean, std::vector<unsigned char> & all, unsigned char & value)
+	{
+		clean.clear();
+		all.clear();
+		all.push_back(img.ptr(y)[x]);
+
+		// grow the window one ring at a time
+		for (int r = 1; r <= k_max / 2; r++)
+		{
+			for (int yy = y - r; yy <= y + r; yy++)
+			{
+				int yc = clampIndex(yy, img.rows);
+				const unsigned char* yRow = img.ptr(yc);
+				const unsigned char* candidates_yRow = candidates.ptr(yc);
+
+				// top and bottom rows of the ring are complete, the others only have the two end pixels
+				int step = (yy == y - r || yy == y + r) ? 1 : 2 * r;
+				for (int xx = x - r; xx <= x + r; xx += step)
+				{
+					int xc = clampIndex(xx, img.cols);
+					all.push_back(yRow[xc]);
+					if (!candidates_yRow[xc])
+						clean.push_back(yRow[xc]);
+				}
+			}
+
+			if (!clean.empty())
+			{
+				std::nth_element(clean.begin(), clean.begin() + clean.size() / 2, clean.end());
+				value = clean[clean.size() / 2];
+				return r - 1;
+			}
+		}
+
+		std::nth_element(all.begin(), all.begin() + all.size() / 2, all.end());
+		value = all[all.size() / 2];
+		return -1;
+	}
+
+	// comparator of a sorting network: wire 'a' gets the minimum and wire 'b' the maximum
+	struct Comparator
+	{
+		int a, b;
+	};
+
+	// median selection network for k x k windows (k <= 7), obtained by pruning Batcher's
+	// odd-even merge sort of the window arranged as P x P wires (P = k rounded up to a power of 2)
+	// - wires outside the window are padded with the maximum value, so comparators that involve
+	//   them are either removed or turned into wire relabelings
+	// - the first stage of the network only sorts the k values of each column: since this does not
+	//   depend on the window position, it is computed once per column and shared by k windows
+	// - the second stage merges the k sorted columns, and only keeps the comparators the median depends on
+	struct MedianNetwork
+	{
+		int k;
+		int P;								// wire = column * P + row
+		std::vector<Comparator> column_stage;	// sorts a column (wires 0..k-1)
+		std::vector<Comparator> merge_stage;	// finds the median among the sorted columns
+		std::vector<int> merge_inputs;			// wires read by the merge stage
+		int median_wire;
+
+		MedianNetwork(int _k) : k(_k)
+		{
+			P = 1;
+			while (P < k)
+				P <<= 1;
+			int N = P * P;
+
+			// logical wire -> physical wire (= where its value is stored)
+			std::vector<int> slot(N);
+			std::vector<char> is_pad(N);
+			for (int w = 0; w < N; w++)
+			{
+				slot[w] = w;
+				is_pad[w] = w / P >= k || w % P >= k;
+			}
+
+			// Batcher's odd-even merge sort
+			std::vector<Comparator> columns_all, merge_all;
+			for (int p = 1; p < N; p <<= 1)
+				for (int d = p; d >= 1; d >>= 1)
+					for (int j = d % p; j + d < N; j += 2 * d)
+						for (int i = 0; i < d && i + j + d < N; i++)
+						{
+							int lo = i + j;
+							int hi = i + j + d;
+							if ((lo / (2 * p)) != (hi / (2 * p)))
+								continue;
+
+							// max(x, pad) = pad: nothing to do
+							if (is_pad[hi])
+								continue;
+							// min(pad, x) = x: the two values just swap their place
+							if (is_pad[lo])
+							{
+								std::swap(slot[lo], slot[hi]);
+								std::swap(is_pad[lo], is_pad[hi]);
+								continue;
+							}
+							Comparator c = { slot[lo], slot[hi] };
+							(p < P ? columns_all : merge_all).push_back(c);
+						}
+			median_wire = slot[(k * k) / 2];
+
+			// prune the merge stage: walk it backwards and keep only
+			// the comparators that (indirectly) write to the median wire
+			std::vector<bool> needed(N, false);
+			needed[median_wire] = true;
+			for (int i = int(merge_all.size()) - 1; i >= 0; i--)
+				if (needed[merge_all[i].a] || needed[merge_all[i].b])
+				{
+					merge_stage.push_back(merge_all[i]);
+					needed[merge_all[i].a] = needed[merge_all[i].b] = true;
+				}
+			std::reverse(merge_stage.begin(), merge_stage.end());
+			for (int w = 0; w < N; w++)
+				if (needed[w])
+					merge_inputs.push_back(w);
+
+			// all columns are sorted the same way: keep the comparators of the first one
+			// (wires are only relabeled within a column, so it always uses wires 0..k-1)
+			for (auto & c : columns_all)
+				if (c.b < P)
+					column_stage.push_back(c);
+		}
+	};
+
+	// vector operations used by the median networks: one scalar version
+	// and one version for each SIMD register width
+	struct ScalarOps
+	{
+		typedef unsigned char vec;
+		enum { nlanes = 1 };
+		static inline vec load(const unsigned char* p) { return *p; }
+		static inline void store(unsigned char* p, const vec & v) { *p = v; }
+		static inline vec min(const vec & a, const vec & b) { return std::min(a, b); }
+		static inline vec max(const vec & a, const vec & b) { return std::max(a, b); }
+	};
+#if CV_SIMD128
+	struct Simd128Ops
+	{
+		typedef cv::v_uint8x16 vec;
+		enum { nlanes = 16 };
+		static inline vec load(const unsigned char* p) { return cv::v_load(p); }
+		static inline void store(unsigned char* p, const vec & v) { cv::v_store(p, v); }
+		static inline vec min(const vec & a, const vec & b) { return cv::v_min(a, b); }
+		static inline vec max(const vec & a, const vec & b) { return cv::v_max(a, b); }
+	};
+#endif
+#if CV_SIMD256
+	struct Simd256Ops
+	{
+		typedef cv::v_uint8x32 vec;
+		enum { nlanes = 32 };
+		static inline vec load(const unsigned char* p) { return cv::v256_load(p); }
+		static inline void store(unsigned char* p, const vec & v) { cv::v_store(p, v); }
+		static inline vec min(const vec & a, const vec & b) { return cv::v_min(a, b); }
+		static inline vec max(const vec & a, const vec & b) { return cv::v_max(a, b); }
+	};
+#endif
+#if CV_SIMD512
+	struct Simd512Ops
+	{
+		typedef cv::v_uint8x64 vec;
+		enum { nlanes = 64 };
+		static inline vec load(const unsigned char* p) { return cv::v512_load(p); }
+		static inline void store(unsigned char* p, const vec & v) { cv::v_store(p, v); }
+		static inline vec min(const vec & a, const vec & b) { return cv::v_min(a, b); }
+		static inline vec max(const vec & a, const vec & b) { return cv::v_max(a, b); }
+	};
+#endif
+
+	// apply the comparators of 'network' to wires 'w'
+	template <typename Ops>
+	inline void applyNetwork(const std::vector<Comparator> & network, typename Ops::vec* w)
+	{
+		for (auto & c : network)
+		{
+			typename Ops::vec lo = Ops::min(w[c.a], w[c.b]);
+			w[c.b] = Ops::max(w[c.a], w[c.b]);
+			w[c.a] = lo;
+		}
+	}
+
+	// median filtering of rows [y0, y1) of 'img' with a median network,
+	// processing Ops::nlanes row elements (pixels x channels) at a time
+	template <typename Ops>
+	void medianNetworkBand(const cv::Mat & img, cv::Mat & out_img, const MedianNetwork & net, int y0, int y1)
+	{
+		int k = net.k;
+		int r = k / 2;
+		int cn = img.channels();
+		int len = img.cols * cn;
+		int padded_len = (img.cols + 2 * r) * cn;
+
+		// the k rows of the current window, with replicated left / right borders (ring buffer)
+		// and the sorted columns of the current window rows
+		std::vector<unsigned char> buffer(2 * k * padded_len);
+		std::vector<unsigned char*> window_rows(k), sorted_rows(k);
+		for (int q = 0; q < k; q++)
+		{
+			window_rows[q] = &buffer[q * padded_len];
+			sorted_rows[q] = &buffer[(k + q) * padded_len];
+		}
+		auto padRow = [&](int y, unsigned char* dst)
+		{
+			const unsigned char* yRow = img.ptr(clampIndex(y, img.rows));
+			for (int x = 0; x < r; x++)
+			{
+				std::memcpy(dst + x * cn, yRow, cn);
+				std::memcpy(dst + (r + img.cols + x) * cn, yRow + (img.cols - 1) * cn, cn);
+			}
+			std::memcpy(dst + r * cn, yRow, len);
+		};
+		for (int q = 0; q < k; q++)
+			padRow(y0 - r + q, window_rows[q]);
+
+		typename Ops::vec w_vec[64];
+		ScalarOps::vec w_scalar[64];
+		for (int y = y0; y < y1; y++)
+		{
+			// slide window down by one row: the oldest row is replaced by the new one
+			if (y > y0)
+			{
+				std::rotate(window_rows.begin(), window_rows.begin() + 1, window_rows.end());
+				padRow(y + r, window_rows[k - 1]);
+			}
+
+			// sort columns
+			int i = 0;
+			for (; i <= padded_len - Ops::nlanes; i += Ops::nlanes)
+			{
+				for (int q = 0; q < k; q++)
+					w_vec[q] = Ops::load(window_rows[q] + i);
+				applyNetwork<Ops>(net.column_stage, w_vec);
+				for (int q = 0; q < k; q++)
+					Ops::store(sorted_rows[q] + i, w_vec[q]);
+			}
+			for (; i < padded_len; i++)
+			{
+				for (int q = 0; q < k; q++)
+					w_scalar[q] = window_rows[q][i];
+				applyNetwork<ScalarOps>(net.column_stage, w_scalar);
+				for (int q = 0; q < k; q++)
+					sorted_rows[q][i] = w_scalar[q];
+			}
+
+			// merge the k sorted columns of each window
+			unsigned char* out_yRow = out_img.ptr(y);
+			i = 0;
+			for (; i <= len - Ops::nlanes; i += Ops::nlanes)
+			{
+				for (int wire : net.merge_inputs)
+					w_vec[wire] = Ops::load(sorted_rows[wire % net.P] + i + (wire / net.P) * cn);
+				applyNetwork<Ops>(net.merge_stage, w_vec);
+				Ops::store(out_yRow + i, w_vec[net.median_wire]);
+			}
+			for (; i < len; i++)
+			{
+				for (int wire : net.merge_inputs)
+					w_scalar[wire] = sorted_rows[wire % net.P][i + (wire / net.P) * cn];
+				applyNetwork<ScalarOps>(net.merge_stage, w_scalar);
+				out_yRow[i] = w_scalar[net.median_wire];
+			}
+		}
+	}
+
+	template <typename Ops>
+	void medianNetwork(const cv::Mat & img, cv::Mat & out_img, const MedianNetwork & net)
+	{
+		int n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows / net.k));
+		cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+		{
+			for (int band = bands.start; band < bands.end; band++)
+				medianNetworkBand<Ops>(img, out_img, net, band * img.rows / n_bands, (band + 1) * img.rows / n_bands);
+		});
+	}
+
+	// histogram of rows [y0, y1) counted on 'n_banks' interleaved banks of 'n_bins' counters each
+	// (pixels outside 'mask' are counted as 0, so that the loop has no branches)
+	template <typename T, int n_banks>
+	void histogramBand(const cv::Mat & img, const cv::Mat & mask, int y0, int y1, unsigned int* banks, int n_bins)
+	{
+		unsigned int* bank[n_banks];
+		for (int b = 0; b < n_banks; b++)
+			bank[b] = banks + b * n_bins;
+
+		int len = img.cols * img.channels();
+		for (int y = y0; y < y1; y++)
+		{
+			const T* yRow = img.ptr<T>(y);
+			int x = 0;
+			if (mask.empty())
+			{
+				for (; x <= len - n_banks; x += n_banks)
+					for (int b = 0; b < n_banks; b++)
+						bank[b][yRow[x + b]]++;
+				for (; x < len; x++)
+					bank[0][yRow[x]]++;
+			}
+			else
+			{
+				const unsigned char* mask_yRow = mask.ptr(y);
+				for (; x <= len - n_banks; x += n_banks)
+					for (int b = 0; b < n_banks; b++)
+						bank[b][yRow[x + b]] += mask_yRow[x + b] != 0;
+				for (; x < len; x++)
+					bank[0][yRow[x]] += mask_yRow[x] != 0;
+			}
+		}
+	}
+
+	// parallel histogram: each row band has its own banks, which are all summed at the end
+	// (16-bit images use fewer banks to keep them in cache)
+	template <typename T, int n_banks>
+	std::vector<int> histogramParallel(const cv::Mat & img, const cv::Mat & mask, int L)
+	{
+		int n_bins = 1 << (8 * sizeof(T));
+		int n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows));
+		std::vector<std::vector<unsigned int> > band_banks(n_bands, std::vector<unsigned int>(n_banks * n_bins, 0));
+		cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+		{
+			for (int band = bands.start; band < bands.end; band++)
+				histogramBand<T, n_banks>(img, mask, band * img.rows / n_bands, (band + 1) * img.rows / n_bands,
+					band_banks[band].data(), n_bins);
+		});
+
+		std::vector<int> histo(L, 0);
+		for (int band = 0; band < n_bands; band++)
+			for (int b = 0; b < n_banks; b++)
+			{
+				const unsigned int* bank = &band_banks[band][b * n_bins];
+				for (int i = 0; i < L; i++)
+					histo[i] += bank[i];
+			}
+		return histo;
+	}
+
+	std::vector<int> histogramImpl(const cv::Mat & img, const cv::Mat & mask, int L)
+	{
+		// precondition checks
+		if (img.depth() != CV_8U && img.depth() != CV_16U)
+			throw aia::error("histogram: only 8- and 16-bit images are supported");
+		if (!mask.empty() && (mask.type() != CV_8U || mask.size() != img.size() || img.channels() != 1))
+			throw aia::error("histogram: mask must be an 8-bit image of the same size of the (grayscale) image");
+
+		int max_L = img.depth() == CV_8U ? 256 : 65536;
+		L = L > 0 ? std::min(L, max_L) : max_L;
+
+		if (img.depth() == CV_8U)
+			return histogramParallel<unsigned char, 4>(img, mask, L);
+		else
+			return histogramParallel<unsigned short, 2>(img, mask, L);
+	}
+
+	// CLAHE tiling (same conventions as cv::CLAHE): all tiles have the same size, and tiles on
+	// the right / bottom border read the image as if it was padded by mirroring (BORDER_REFLECT_101)
+	struct ClaheGrid
+	{
+		cv::Size grid;			// number of tiles along x and y
+		cv::Size tile_size;		// size of each tile
+		int n_bins;				// number of bins of the tile histograms
+		int shift;				// gray level --> bin shift
+		int max_level;			// maximum output gray level
+
+		// L and n_bins must be powers of 2
+		ClaheGrid(cv::Size img_size, cv::Size _grid, int L, int _n_bins)
+		{
+			grid.width = std::max(1, std::min(_grid.width, img_size.width));
+			grid.height = std::max(1, std::min(_grid.height, img_size.height));
+			tile_size.width = (img_size.width + grid.width - 1) / grid.width;
+			tile_size.height = (img_size.height + grid.height - 1) / grid.height;
+			n_bins = std::min(_n_bins, L);
+			shift = 0;
+			while ((L >> shift) > n_bins)
+				shift++;
+			max_level = L - 1;
+		}
+	};
+
+	// histograms of the CLAHE tiles (one row of 'histos' per tile), computed in parallel
+	// (gray levels >= L are counted in the last bin)
+	template <typename T>
+	void claheHistograms(const cv::Mat & img, const ClaheGrid & g, cv::Mat & histos)
+	{
+		histos = cv::Mat::zeros(g.grid.area(), g.n_bins, CV_32S);
+		cv::parallel_for_(cv::Range(0, g.grid.area()), [&](const cv::Range & range)
+		{
+			std::vector<int> x_mirror(g.tile_size.width);
+			for (int t = range.start; t < range.end; t++)
+			{
+				int* histo = histos.ptr<int>(t);
+				int x0 = (t % g.grid.width) * g.tile_size.width;
+				int y0 = (t / g.grid.width) * g.tile_size.height;
+				bool inside = x0 + g.tile_size.width <= img.cols;
+				if (!inside)
+					for (int x = 0; x < g.tile_size.width; x++)
+						x_mirror[x] = cv::borderInterpolate(x0 + x, img.cols, cv::BORDER_REFLECT_101);
+
+				for (int y = y0; y < y0 + g.tile_size.height; y++)
+				{
+					const T* yRow = img.ptr<T>(cv::borderInterpolate(y, img.rows, cv::BORDER_REFLECT_101));
+					if (inside)
+						for (int x = x0; x < x0 + g.tile_size.width; x++)
+							histo[std::min(yRow[x] >> g.shift, g.n_bins - 1)]++;
+					else
+						for (int x = 0; x < g.tile_size.width; x++)
+							histo[std::min(yRow[x_mirror[x]] >> g.shift, g.n_bins - 1)]++;
+				}
+			}
+		});
+	}
+
+	// CLAHE tile LUTs (one row of 'luts' per tile), computed in parallel: each histogram is clipped
+	// (OpenCV's clip limit convention, clip = 0 means no clipping), the clipped counts are
+	// redistributed uniformly and the result is accumulated and scaled to [0, max_level]
+	// NOTE: LUT values are rounded as in OpenCV, but stored as float for the interpolation
+	void claheLUTs(const cv::Mat & histos, const ClaheGrid & g, double clip, cv::Mat & luts)
+	{
+		int tile_area = g.tile_size.area();
+		int clip_limit = clip > 0 ? std::max(1, int(clip * tile_area / g.n_bins)) : 0;
+		float lut_scale = float(g.max_level) / tile_area;
+
+		luts.create(histos.rows, g.n_bins, CV_32F);
+		cv::parallel_for_(cv::Range(0, histos.rows), [&](const cv::Range & range)
+		{
+			std::vector<int> histo(g.n_bins);
+			for (int t = range.start; t < range.end; t++)
+			{
+				std::copy(histos.ptr<int>(t), histos.ptr<int>(t) + g.n_bins, histo.begin());
+				if (clip_limit > 0)
+				{
+					int clipped = 0;
+					for (int i = 0; i < g.n_bins; i++)
+						if (histo[i] > clip_limit)
+						{
+							clipped += histo[i] - clip_limit;
+							histo[i] = clip_limit;
+						}
+
+					int redist = clipped / g.n_bins;
+					int residual = clipped - redist * g.n_bins;
+					for (int i = 0; i < g.n_bins; i++)
+						histo[i] += redist;
+					if (residual > 0)
+					{
+						int residual_step = std::max(g.n_bins / residual, 1);
+						for (int i = 0; i < g.n_bins && residual > 0; i += residual_step, residual--)
+							histo[i]++;
+					}
+				}
+
+				float* lut = luts.ptr<float>(t);
+				int acc = 0;
+				for (int i = 0; i < g.n_bins; i++)
+				{
+					acc += histo[i];
+					lut[i] = float(std::min(cvRound(acc * lut_scale), g.max_level));
+				}
+			}
+		});
+	}
+
+#if CV_SIMD128
+	// load 4 gray levels as 32-bit integers
+	inline cv::v_int32x4 loadLevels(const unsigned char* p) { return cv::v_reinterpret_as_s32(cv::v_load_expand_q(p)); }
+	inline cv::v_int32x4 loadLevels(const unsigned short* p) { return cv::v_reinterpret_as_s32(cv::v_load_expand(p)); }
+
+	// round, saturate and store 8 gray levels
+	inline void storeLevels(unsigned char* p, const cv::v_float32x4 & a, const cv::v_float32x4 & b)
+	{
+		cv::v_pack_u_store(p, cv::v_pack(cv::v_round(a), cv::v_round(b)));
+	}
+	inline void storeLevels(unsigned short* p, const cv::v_float32x4 & a, const cv::v_float32x4 & b)
+	{
+		cv::v_store(p, cv::v_pack_u(cv::v_round(a), cv::v_round(b)));
+	}
+#endif
+
+	// CLAHE bilinear interpolation of rows [y0, y1) between the LUTs of the four tiles closest to each pixel
+	// - tile indices and weights along x only depend on the column, and are precomputed
+	// - LUT values are gathered with scalar loads, while the blending is done 4 pixels at a time
+	template <typename T>
+	void claheInterpolateBand(const cv::Mat & img, cv::Mat & out_img, const ClaheGrid & g, const cv::Mat & luts,
+		const std::vector<int> & x_offset1, const std::vector<int> & x_offset2, const std::vector<float> & x_weight, int y0, int y1)
+	{
+		float inv_th = 1.0f / g.tile_size.height;
+		for (int y = y0; y < y1; y++)
+		{
+			float tyf = y * inv_th - 0.5f;
+			int ty1 = cvFloor(tyf);
+			int ty2 = ty1 + 1;
+			float ya = tyf - ty1;
+			float ya1 = 1.0f - ya;
+			ty1 = std::max(ty1, 0);
+			ty2 = std::min(ty2, g.grid.height - 1);
+
+			// LUTs of the tile rows above and below (offsets select the tile and the bin)
+			const float* lut1 = luts.ptr<float>(ty1 * g.grid.width);
+			const float* lut2 = luts.ptr<float>(ty2 * g.grid.width);
+			const T* yRow = img.ptr<T>(y);
+			T* out_yRow = out_img.ptr<T>(y);
+
+			int x = 0;
+#if CV_SIMD128
+			cv::v_int32x4 v_max_bin = cv::v_setall_s32(g.n_bins - 1);
+			cv::v_float32x4 v_ya = cv::v_setall_f32(ya), v_ya1 = cv::v_setall_f32(ya1), v_one = cv::v_setall_f32(1.0f);
+			for (; x <= img.cols - 8; x += 8)
+			{
+				cv::v_float32x4 res[2];
+				for (int h = 0; h < 2; h++)
+				{
+					int xh = x + 4 * h;
+					cv::v_int32x4 bin = cv::v_min(loadLevels(yRow + xh) >> g.shift, v_max_bin);
+					cv::v_int32x4 ind1 = cv::v_load(&x_offset1[xh]) + bin;
+					cv::v_int32x4 ind2 = cv::v_load(&x_offset2[xh]) + bin;
+					cv::v_float32x4 xa = cv::v_load(&x_weight[xh]);
+					cv::v_float32x4 xa1 = v_one - xa;
+					res[h] = (cv::v_lut(lut1, ind1) * xa1 + cv::v_lut(lut1, ind2) * xa) * v_ya1 +
+						(cv::v_lut(lut2, ind1) * xa1 + cv::v_lut(lut2, ind2) * xa) * v_ya;
+				}
+				storeLevels(out_yRow + x, res[0], res[1]);
+			}
+#endif
+			for (; x < img.cols; x++)
+			{
+				int bin = std::min(yRow[x] >> g.shift, g.n_bins - 1);
+				int ind1 = x_offset1[x] + bin;
+				int ind2 = x_offset2[x] + bin;
+				float xa = x_weight[x];
+				float xa1 = 1.0f - xa;
+				float res = (lut1[ind1] * xa1 + lut1[ind2] * xa) * ya1 + (lut2[ind1] * xa1 + lut2[ind2] * xa) * ya;
+				out_yRow[x] = cv::saturate_cast<T>(res);
+			}
+		}
+	}
+
+	// CLAHE bilinear interpolation over parallel row bands
+	template <typename T>
+	void claheInterpolate(const cv::Mat & img, cv::Mat & out_img, const ClaheGrid & g, const cv::Mat & luts)
+	{
+		// left / right tile (as offset in the LUTs of a tile row) and weight of the right tile for each column
+		std::vector<int> x_offset1(img.cols), x_offset2(img.cols);
+		std::vector<float> x_weight(img.cols);
+		float inv_tw = 1.0f / g.tile_size.width;
+		for (int x = 0; x < img.cols; x++)
+		{
+			float txf = x * inv_tw - 0.5f;
+			int tx1 = cvFloor(txf);
+			x_weight[x] = txf - tx1;
+			x_offset1[x] = std::max(tx1, 0) * g.n_bins;
+			x_offset2[x] = std::min(tx1 + 1, g.grid.width - 1) * g.n_bins;
+		}
+
+		int n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows));
+		cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+		{
+			for (int band = bands.start; band < bands.end; band++)
+				claheInterpolateBand<T>(img, out_img, g, luts, x_offset1, x_offset2, x_weight,
+					band * img.rows / n_bands, (band + 1) * img.rows / n_bands);
+		});
+	}
+
+	// complete CLAHE pipeline on a single channel (histograms and LUTs are also returned)
+	void claheImpl(const cv::Mat & img, cv::Mat & out_img, const ClaheGrid & g, double clip, cv::Mat & histos, cv::Mat & luts)
+	{
+		if (histos.empty())
+		{
+			if (img.depth() == CV_8U)
+				claheHistograms<unsigned char>(img, g, histos);
+			else
+				claheHistograms<unsigned short>(img, g, histos);
+		}
+		if (luts.empty())
+			claheLUTs(histos, g, clip, luts);
+
+		out_img = cv::Mat(img.rows, img.cols, img.type());
+		if (img.depth() == CV_8U)
+			claheInterpolate<unsigned char>(img, out_img, g, luts);
+		else
+			claheInterpolate<unsigned short>(img, out_img, g, luts);
+	}
+
+	// V = max(B, G, R) of rows [y0, y1)
+	template <typename T>
+	void colorValueBand(const cv::Mat & img, cv::Mat & value, int y0, int y1)
+	{
+		for (int y = y0; y < y1; y++)
+		{
+			const T* yRow = img.ptr<T>(y);
+			T* value_yRow = value.ptr<T>(y);
+			for (int x = 0; x < img.cols; x++)
+				value_yRow[x] = std::max(std::max(yRow[3 * x], yRow[3 * x + 1]), yRow[3 * x + 2]);
+		}
+	}
+
+	// scaling of B, G, R by V' / V on rows [y0, y1) ('inv_value' = LUT of 1 / V)
+	template <typename T>
+	void valueGainBand(const cv::Mat & img, const cv::Mat & value, const cv::Mat & value_eq, const std::vector<float> & inv_value,
+		cv::Mat & out_img, int y0, int y1)
+	{
+		for (int y = y0; y < y1; y++)
+		{
+			const T* yRow = img.ptr<T>(y);
+			const T* value_yRow = value.ptr<T>(y);
+			const T* value_eq_yRow = value_eq.ptr<T>(y);
+			T* out_yRow = out_img.ptr<T>(y);
+			for (int x = 0; x < img.cols; x++)
+			{
+				// black pixels have no hue: they become gray pixels with the new value
+				if (value_yRow[x] == 0)
+				{
+					out_yRow[3 * x] = out_yRow[3 * x + 1] = out_yRow[3 * x + 2] = value_eq_yRow[x];
+					continue;
+				}
+				float gain = value_eq_yRow[x] * inv_value[value_yRow[x]];
+				for (int c = 0; c < 3; c++)
+					out_yRow[3 * x + c] = cv::saturate_cast<T>(yRow[3 * x + c] * gain);
+			}
+		}
+	}
+
+	// Young & van Vliet recursion y[n] = B x[n] + a[0] y[n-1] + a[1] y[n-2] + a[2] y[n-3]
+	// and Triggs & Sdika matrix to initialize the anticausal pass
+	struct RecursiveGaussian
+	{
+		double B, a[3], M[9];
+
+		RecursiveGaussian(double sigma)
+		{
+			double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * std::sqrt(1 - 0.26891 * sigma);
+			double b0 = 1.57825 + 2.44413 * q + 1.4281 * q * q + 0.422205 * q * q * q;
+			a[0] = (2.44413 * q + 2.85619 * q * q + 1.26661 * q * q * q) / b0;
+			a[1] = -(1.4281 * q * q + 1.26661 * q * q * q) / b0;
+			a[2] = 0.422205 * q * q * q / b0;
+			B = 1 - (a[0] + a[1] + a[2]);
+
+			double a1 = a[0], a2 = a[1], a3 = a[2];
+			double scale = 1.0 / ((1 + a1 - a2 + a3) * (1 - a1 - a2 - a3) * (1 + a2 + (a1 - a3) * a3));
+			M[0] = scale * (-a3 * a1 + 1 - a3 * a3 - a2);
+			M[1] = scale * (a3 + a1) * (a2 + a3 * a1);
+			M[2] = scale * a3 * (a1 + a3 * a2);
+			M[3] = scale * (a1 + a3 * a2);
+			M[4] = -scale * (a2 - 1) * (a2 + a3 * a1);
+			M[5] = -scale * a3 * (a3 * a1 + a3 * a3 + a2 - 1);
+			M[6] = scale * (a3 * a1 + a2 + a1 * a1 - a2 * a2);
+			M[7] = scale * (a1 * a2 + a3 * a2 * a2 - a1 * a3 * a3 - a3 * a3 * a3 - a3 * a2 + a3);
+			M[8] = scale * a3 * (a1 + a3 * a2);
+		}
+
+		// anticausal values y[n-1], y[n], y[n+1] of a signal of n samples whose last input sample 'x_last'
+		// is replicated to infinity, given the last causal outputs u[n-1], u[n-2], u[n-3]
+		inline void anticausalInit(double u1, double u2, double u3, double x_last, double* y) const
+		{
+			u1 -= x_last;
+			u2 -= x_last;
+			u3 -= x_last;
+			for (int i = 0; i < 3; i++)
+				y[i] = B * (M[3 * i] * u1 + M[3 * i + 1] * u2 + M[3 * i + 2] * u3) + x_last;
+		}
+	};
+
+	// recursive Gaussian filtering (in place) of the 'n' samples p[0], p[step], ..., p[(n-1)*step]
+	void recursiveGaussianLine(double* p, int n, int step, const RecursiveGaussian & g)
+	{
+		// causal pass, initialized with the steady state of the replicated first sample
+		double x_first = p[0];
+		double x_last = p[(n - 1) * step];
+		double u1 = x_first, u2 = x_first, u3 = x_first;
+		for (int i = 0; i < n; i++)
+		{
+			double u = g.B * p[i * step] + g.a[0] * u1 + g.a[1] * u2 + g.a[2] * u3;
+			p[i * step] = u;
+			u3 = u2;
+			u2 = u1;
+			u1 = u;
+		}
+
+		// anticausal pass, u1 / u2 / u3 are now the last three causal outputs
+		double y[3];
+		g.anticausalInit(u1, u2, u3, x_last, y);
+		p[(n - 1) * step] = y[0];
+		double y1 = y[0], y2 = y[1], y3 = y[2];
+		for (int i = n - 2; i >= 0; i--)
+		{
+			double v = g.B * p[i * step] + g.a[0] * y1 + g.a[1] * y2 + g.a[2] * y3;
+			p[i * step] = v;
+			y3 = y2;
+			y2 = y1;
+			y1 = v;
+		}
+	}
+
+	// recursive Gaussian filtering (in place) of columns [x0, x1) of 'buf' (in elements, i.e. pixels x channels):
+	// all columns of the strip are processed together one row at a time
+	void recursiveGaussianColumns(cv::Mat & buf, int x0, int x1, const RecursiveGaussian & g)
+	{
+		int n = buf.rows;
+		int width = x1 - x0;
+
+		// causal pass, rows above the first one are the replicated first row (steady state)
+		std::vector<double> first(buf.ptr<double>(0) + x0, buf.ptr<double>(0) + x1);
+		std::vector<double> last(buf.ptr<double>(n - 1) + x0, buf.ptr<double>(n - 1) + x1);
+		for (int y = 0; y < n; y++)
+		{
+			double* u = buf.ptr<double>(y) + x0;
+			const double* u1 = y >= 1 ? buf.ptr<double>(y - 1) + x0 : first.data();
+			const double* u2 = y >= 2 ? buf.ptr<double>(y - 2) + x0 : first.data();
+			const double* u3 = y >= 3 ? buf.ptr<double>(y - 3) + x0 : first.data();
+			for (int x = 0; x < width; x++)
+				u[x] = g.B * u[x] + g.a[0] * u1[x] + g.a[1] * u2[x] + g.a[2] * u3[x];
+		}
+
+		// anticausal pass, rows below the last one are given by the Triggs & Sdika initialization
+		std::vector<double> after1(width), after2(width);
+		{
+			double* y_last = buf.ptr<double>(n - 1) + x0;
+			const double* u2 = n >= 2 ? buf.ptr<double>(n - 2) + x0 : first.data();
+			const double* u3 = n >= 3 ? buf.ptr<double>(n - 3) + x0 : first.data();
+			for (int x = 0; x < width; x++)
+			{
+				double y[3];
+				g.anticausalInit(y_last[x], u2[x], u3[x], last[x], y);
+				y_last[x] = y[0];
+				after1[x] = y[1];
+				after2[x] = y[2];
+			}
+		}
+		for (int y = n - 2; y >= 0; y--)
+		{
+			double* v = buf.ptr<double>(y) + x0;
+			const double* y1 = buf.ptr<double>(y + 1) + x0;
+			const double* y2 = y + 2 < n ? buf.ptr<double>(y + 2) + x0 : after1.data();
+			const double* y3 = y + 3 < n ? buf.ptr<double>(y + 3) + x0 : (y + 3 == n ? after1.data() : after2.data());
+			for (int x = 0; x < width; x++)
+				v[x] = g.B * v[x] + g.a[0] * y1[x] + g.a[1] * y2[x] + g.a[2] * y3[x];
+		}
+	}
+
+	// dst[i] += w * src[i] for i in [0, n)
+	inline void accumulateScaled(float* dst, const float* src, float w, int n)
+	{
+		int i = 0;
+#if CV_SIMD128
+		cv::v_float32x4 v_w = cv::v_setall_f32(w);
+		for (; i <= n - 4; i += 4)
+			cv::v_store(dst + i, cv::v_load(dst + i) + cv::v_load(src + i) * v_w);
+#endif
+		for (; i < n; i++)
+			dst[i] += w * src[i];
+	}
+
+	// unsharp masking of rows [y0, y1) with the separable 'kernel'
+	template <typename T>
+	void unsharpMaskBand(const cv::Mat & img, cv::Mat & out_img, const cv::Mat & kernel, const cv::Scalar & amounts,
+		float threshold, int y0, int y1)
+	{
+		int cn = img.channels();
+		int n = img.cols * cn;
+		int ksize = kernel.rows;
+		int r = ksize / 2;
+		const float* w = kernel.ptr<float>();
+
+		// ring of horizontally smoothed rows (row y is stored in slot (y - y0 + r) % ksize), a
+		// horizontally padded source row, the blurred row and the amount of each row element
+		std::vector<float> ring(ksize * n), padded((img.cols + 2 * r) * cn), blurred(n), amount(n);
+		for (int i = 0; i < n; i++)
+			amount[i] = float(amounts[i % cn]);
+
+		auto smoothRow = [&](int y)
+		{
+			const T* yRow = img.ptr<T>(cv::borderInterpolate(y, img.rows, cv::BORDER_REFLECT_101));
+			for (int x = -r; x < img.cols + r; x++)
+			{
+				const T* pixel = yRow + cv::borderInterpolate(x, img.cols, cv::BORDER_REFLECT_101) * cn;
+				for (int c = 0; c < cn; c++)
+					padded[(x + r) * cn + c] = float(pixel[c]);
+			}
+			float* dst = &ring[((y - y0 + r) % ksize) * n];
+			std::fill(dst, dst + n, 0.0f);
+			for (int k = 0; k < ksize; k++)
+				accumulateScaled(dst, &padded[k * cn], w[k], n);
+		};
+
+		for (int y = y0 - r; y < y0 + r; y++)
+			smoothRow(y);
+		for (int y = y0; y < y1; y++)
+		{
+			smoothRow(y + r);
+
+			// vertical smoothing
+			std::fill(blurred.begin(), blurred.end(), 0.0f);
+			for (int k = 0; k < ksize; k++)
+				accumulateScaled(blurred.data(), &ring[((y + k - y0) % ksize) * n], w[k], n);
+
+			// signed detail, threshold, amount and saturation
+			const T* yRow = img.ptr<T>(y);
+			T* out_yRow = out_img.ptr<T>(y);
+			for (int i = 0; i < n; i++)
+			{
+				float detail = yRow[i] - blurred[i];
+				if (std::abs(detail) < threshold)
+					detail = 0;
+				out_yRow[i] = cv::saturate_cast<T>(yRow[i] + amount[i] * detail);
+			}
+		}
+	}
+
+	// bilateral grid (Paris & Durand, 2006) of a single-channel image: cells are 'sigma_space' wide along x and y
+	// and 'sigma_color' wide along gray levels, each one stores the sum of the (splatted) gray levels and their weight
+	// - cells are stored by planes (one for each y), each plane by rows (one for each gray level)
+	// - 'pad' empty cells on each side, so that the blur does not need to check the borders
+	// - grids larger than 'max_bytes' are not allocated (see bilateralGrid)
+	struct BilateralGrid
+	{
+		static const int pad = 2;
+		static const size_t max_bytes = size_t(512) << 20;
+		int width, height, depth;	// number of cells along x, y and gray levels
+		float sigma_space, sigma_color, min_level;
+		std::vector<float> cells;	// (sum, weight) pairs
+
+		BilateralGrid(const cv::Mat & img, double _sigma_space, double _sigma_color)
+			: sigma_space(float(_sigma_space)), sigma_color(float(_sigma_color))
+		{
+			double min_val, max_val;
+			cv::minMaxLoc(img, &min_val, &max_val);
+			min_level = float(min_val);
+			width = int((img.cols - 1) / sigma_space) + 1 + 2 * pad;
+			height = int((img.rows - 1) / sigma_space) + 1 + 2 * pad;
+			depth = int(std::min((max_val - min_val) / sigma_color, 1e9)) + 1 + 2 * pad;
+		}
+
+		inline size_t planeSize() const { return size_t(depth) * width * 2; }
+		inline double bytes() const { return double(planeSize()) * height * sizeof(float); }
+		inline size_t index(int gx, int gy, int gz) const { return (size_t(gy) * depth + gz) * width * 2 + gx * 2; }
+
+		// grid coordinates of pixel (x, y) with gray level v
+		inline void coords(int x, int y, float v, float & fx, float & fy, float & fz) const
+		{
+			fx = x / sigma_space + pad;
+			fy = y / sigma_space + pad;
+			fz = (v - min_level) / sigma_color + pad;
+		}
+	};
+
+	// trilinear splatting of rows [y0, y1) on the grid planes [gy0, gy0 + planes.size() / planeSize())
+	template <typename T>
+	void bilateralGridSplat(const cv::Mat & img, const BilateralGrid & grid, int y0, int y1, int gy0, std::vector<float> & planes)
+	{
+		for (int y = y0; y < y1; y++)
+		{
+			const T* yRow = img.ptr<T>(y);
+			for (int x = 0; x < img.cols; x++)
+			{
+				float fx, fy, fz;
+				grid.coords(x, y, float(yRow[x]), fx, fy, fz);
+				int ix = int(fx), iy = int(fy), iz = int(fz);
+				float ax = fx - ix, ay = fy - iy, az = fz - iz;
+				for (int dy = 0; dy < 2; dy++)
+					for (int dz = 0; dz < 2; dz++)
+						for (int dx = 0; dx < 2; dx++)
+						{
+							float w = (dx ? ax : 1 - ax) * (dy ? ay : 1 - ay) * (dz ? az : 1 - az);
+							float* cell = &planes[grid.index(ix + dx, iy + dy - gy0, iz + dz)];
+							cell[0] += w * yRow[x];
+							cell[1] += w;
+						}
+			}
+		}
+	}
+
+	// in-place [1 1 1] / 3 blur of 'n' consecutive cells of a grid row (stored as (sum, weight) pairs)
+	inline void bilateralGridBlurRow(float* row, int n)
+	{
+		float prev[2] = { 0, 0 };
+		for (int i = 0; i < n; i++)
+			for (int c = 0; c < 2; c++)
+			{
+				float cur = row[2 * i + c];
+				row[2 * i + c] = (prev[c] + cur + (i + 1 < n ? row[2 * i + 2 + c] : 0)) / 3;
+				prev[c] = cur;
+			}
+	}
+
+	// in-place [1 1 1] / 3 blur across 'n' rows of 'len' floats spaced by 'stride' floats
+	// ('prev' and 'cur' are buffers of 'len' floats)
+	inline void bilateralGridBlurAcross(float* first, int n, size_t stride, int len, float* prev, float* cur)
+	{
+		std::fill(prev, prev + len, 0.0f);
+		for (int i = 0; i < n; i++)
+		{
+			float* row = first + i * stride;
+			const float* next = i + 1 < n ? row + stride : 0;
+			std::copy(row, row + len, cur);
+			for (int k = 0; k < len; k++)
+				row[k] = (prev[k] + cur[k] + (next ? next[k] : 0)) / 3;
+			std::swap(prev, cur);
+		}
+	}
+
+	// trilinear slicing of rows [y0, y1)
+	template <typename T>
+	void bilateralGridSlice(const cv::Mat & img, const BilateralGrid & grid, cv::Mat & out_img, int y0, int y1)
+	{
+		for (int y = y0; y < y1; y++)
+		{
+			const T* yRow = img.ptr<T>(y);
+			T* out_yRow = out_img.ptr<T>(y);
+			for (int x = 0; x < img.cols; x++)
+			{
+				float fx, fy, fz;
+				grid.coords(x, y, float(yRow[x]), fx, fy, fz);
+				int ix = int(fx), iy = int(fy), iz = int(fz);
+				float ax = fx - ix, ay = fy - iy, az = fz - iz;
+				float sum = 0, weight = 0;
+				for (int dy = 0; dy < 2; dy++)
+					for (int dz = 0; dz < 2; dz++)
+						for (int dx = 0; dx < 2; dx++)
+						{
+							float w = (dx ? ax : 1 - ax) * (dy ? ay : 1 - ay) * (dz ? az : 1 - az);
+							const float* cell = &grid.cells[grid.index(ix + dx, iy + dy, iz + dz)];
+							sum += w * cell[0];
+							weight += w * cell[1];
+						}
+				out_yRow[x] = cv::saturate_cast<T>(weight > 0 ? sum / weight : yRow[x]);
+			}
+		}
+	}
+
+	template <typename T>
+	void bilateralGridImpl(const cv::Mat & img, cv::Mat & out_img, double sigma_color, double sigma_space)
+	{
+		BilateralGrid grid(img, sigma_space, sigma_color);
+		if (grid.bytes() > BilateralGrid::max_bytes)
+			throw aia::error(aia::strprintf("bilateralGrid: the grid would take %.0f MB (maximum %d MB), use larger sigmas "
+				"or bilateralPermutohedral", grid.bytes() / 1048576, int(BilateralGrid::max_bytes >> 20)));
+		grid.cells.assign(grid.planeSize() * grid.height, 0.0f);
+		size_t plane_size = grid.planeSize();
+
+		// splatting: each row band splats on its own planes, which are then summed
+		// (consecutive bands only share the planes at their boundary)
+		int n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows / std::max(1, int(sigma_space))));
+		std::vector<std::vector<float> > band_planes(n_bands);
+		std::vector<int> band_gy0(n_bands);
+		cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+		{
+			for (int band = bands.start; band < bands.end; band++)
+			{
+				int y0 = band * img.rows / n_bands, y1 = (band + 1) * img.rows / n_bands;
+				float fx, fy0, fy1, fz;
+				grid.coords(0, y0, grid.min_level, fx, fy0, fz);
+				grid.coords(0, y1 - 1, grid.min_level, fx, fy1, fz);
+				band_gy0[band] = int(fy0);
+				band_planes[band].assign((int(fy1) + 2 - int(fy0)) * plane_size, 0.0f);
+				bilateralGridSplat<T>(img, grid, y0, y1, band_gy0[band], band_planes[band]);
+			}
+		});
+		for (int band = 0; band < n_bands; band++)
+		{
+			float* dst = &grid.cells[band_gy0[band] * plane_size];
+			for (size_t i = 0; i < band_planes[band].size(); i++)
+				dst[i] += band_planes[band][i];
+		}
+
+		// blur along x and gray levels (plane by plane), then along y (strip by strip)
+		cv::parallel_for_(cv::Range(0, grid.height), [&](const cv::Range & planes)
+		{
+			std::vector<float> prev(2 * grid.width), cur(2 * grid.width);
+			for (int gy = planes.start; gy < planes.end; gy++)
+			{
+				float* plane = &grid.cells[gy * plane_size];
+				for (int gz = 0; gz < grid.depth; gz++)
+					bilateralGridBlurRow(plane + size_t(gz) * 2 * grid.width, grid.width);
+				bilateralGridBlurAcross(plane, grid.depth, 2 * grid.width, 2 * grid.width, prev.data(), cur.data());
+			}
+		});
+		int n_strips = std::max(1, std::min(cv::getNumThreads(), int(plane_size / 64)));
+		cv::parallel_for_(cv::Range(0, n_strips), [&](const cv::Range & strips)
+		{
+			for (int strip = strips.start; strip < strips.end; strip++)
+			{
+				size_t k0 = strip * plane_size / n_strips, k1 = (strip + 1) * plane_size / n_strips;
+				std::vector<float> prev(k1 - k0), cur(k1 - k0);
+				bilateralGridBlurAcross(&grid.cells[k0], grid.height, plane_size, int(k1 - k0), prev.data(), cur.data());
+			}
+		});
+
+		// slicing
+		n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows));
+		cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+		{
+			for (int band = bands.start; band < bands.end; band++)
+				bilateralGridSlice<T>(img, grid, out_img, band * img.rows / n_bands, (band + 1) * img.rows / n_bands);
+		});
+	}
+
+	// hash table of the points of a permutohedral lattice: keys are the first 'kd' integer coordinates
+	// of each point (the last one is implied), values are 'vd' floats (open addressing, linear probing)
+	class PermutohedralHash
+	{
+		private:
+
+			int kd, vd;
+			std::vector<int> keys;		// keys of the points, in insertion order
+			std::vector<int> table;			// point index of each slot (-1 = empty)
+
+			inline size_t hash(const int* key) const
+			{
+				size_t k = 0;
+				for (int i = 0; i < kd; i++)
+				{
+					k += key[i];
+					k *= 2531011;
+				}
+				return k;
+			}
+
+			void grow()
+			{
+				table.assign(table.size() * 2, -1);
+				for (int i = 0; i < size(); i++)
+				{
+					size_t slot = hash(&keys[i * kd]) % table.size();
+					while (table[slot] != -1)
+						slot = (slot + 1) % table.size();
+					table[slot] = i;
+				}
+			}
+
+		public:
+
+			static const int max_d = 5;		// maximum dimensions of the lattice
+
+			std::vector<float> values;		// values of the points, in insertion order
+
+			PermutohedralHash(int _kd, int _vd, size_t capacity) : kd(_kd), vd(_vd), table(std::max(size_t(16), 2 * capacity), -1) {}
+
+			int size() const { return int(keys.size() / kd); }
+
+			// index of the point with the given key (-1 if not found and 'create' is false)
+			int find(const int* key, bool create)
+			{
+				if (create && 2 * size_t(size()) >= table.size())
+					grow();
+				size_t slot = hash(key) % table.size();
+				while (table[slot] != -1)
+				{
+					if (std::equal(key, key + kd, &keys[table[slot] * kd]))
+						return table[slot];
+					slot = (slot + 1) % table.size();
+				}
+				if (!create)
+					return -1;
+				table[slot] = size();
+				keys.insert(keys.end(), key, key + kd);
+				values.resize(values.size() + vd, 0.0f);
+				return table[slot];
+			}
+
+			// same as above, without insertion (safe to call concurrently)
+			int find(const int* key) const
+			{
+				size_t slot = hash(key) % table.size();
+				while (table[slot] != -1)
+				{
+					if (std::equal(key, key + kd, &keys[table[slot] * kd]))
+						return table[slot];
+					slot = (slot + 1) % table.size();
+				}
+				return -1;
+			}
+
+			const int* key(int i) const { return &keys[i * kd]; }
+	};
+
+	// bilateral filter on the permutohedral lattice (Adams, Baek & Davis, 2010) of 1- or 3-channel images:
+	// pixels are points with position (x / sigma_space, y / sigma_space, channels / sigma_color) in d = 2 + channels
+	// dimensions, which are splatted on the vertices of their enclosing simplex in the lattice, blurred
+	// along each of the d + 1 lattice directions and sliced back
+	template <typename T>
+	void bilateralPermutohedralImpl(const cv::Mat & img, cv::Mat & out_img, double sigma_color, double sigma_space)
+	{
+		const int max_d = PermutohedralHash::max_d;
+		int cn = img.channels();
+		int d = 2 + cn;
+		int vd = cn + 1;	// channels + homogeneous weight
+		int n_pixels = int(img.total());
+
+		// lattice scale factors and canonical simplex
+		float scale_factor[max_d];
+		float inv_std_dev = std::sqrt(2.0f / 3.0f) * (d + 1);
+		for (int i = 0; i < d; i++)
+			scale_factor[i] = inv_std_dev / std::sqrt(float((i + 1) * (i + 2)));
+		int canonical[(max_d + 1) * (max_d + 1)];
+		for (int i = 0; i <= d; i++)
+		{
+			for (int j = 0; j <= d - i; j++)
+				canonical[i * (d + 1) + j] = i;
+			for (int j = d - i + 1; j <= d; j++)
+				canonical[i * (d + 1) + j] = i - (d + 1);
+		}
+
+		// splatting (sequential, since it inserts lattice points): vertices and weights
+		// of each pixel are kept for slicing
+		PermutohedralHash lattice(d, vd, n_pixels);
+		std::vector<int> replay_index(size_t(n_pixels) * (d + 1));
+		std::vector<float> replay_weight(size_t(n_pixels) * (d + 1));
+		for (int y = 0, p = 0; y < img.rows; y++)
+		{
+			const T* yRow = img.ptr<T>(y);
+			for (int x = 0; x < img.cols; x++, p++)
+			{
+				float position[max_d], value[max_d];
+				position[0] = x / float(sigma_space);
+				position[1] = y / float(sigma_space);
+				for (int c = 0; c < cn; c++)
+				{
+					position[2 + c] = yRow[x * cn + c] / float(sigma_color);
+					value[c] = yRow[x * cn + c];
+				}
+				value[cn] = 1;
+
+				// elevate to the hyperplane of the lattice
+				float elevated[max_d + 1];
+				float sm = 0;
+				for (int i = d; i > 0; i--)
+				{
+					float cf = position[i - 1] * scale_factor[i - 1];
+					elevated[i] = sm - i * cf;
+					sm += cf;
+				}
+				elevated[0] = sm;
+
+				// closest remainder-0 point and ranks of the differential
+				int greedy[max_d + 1];
+				int rank[max_d + 1];
+				int sum = 0;
+				for (int i = 0; i <= d; i++)
+				{
+					float v = elevated[i] / (d + 1);
+					float up = std::ceil(v) * (d + 1);
+					float down = std::floor(v) * (d + 1);
+					greedy[i] = int(up - elevated[i] < elevated[i] - down ? up : down);
+					sum += greedy[i];
+					rank[i] = 0;
+				}
+				sum /= d + 1;
+				for (int i = 0; i < d; i++)
+					for (int j = i + 1; j <= d; j++)
+						if (elevated[i] - greedy[i] < elevated[j] - greedy[j])
+							rank[i]++;
+						else
+							rank[j]++;
+				for (int i = 0; i <= d; i++)
+				{
+					if (sum > 0 && rank[i] >= d + 1 - sum)
+					{
+						greedy[i] -= d + 1;
+						rank[i] += sum - (d + 1);
+					}
+					else if (sum < 0 && rank[i] < -sum)
+					{
+						greedy[i] += d + 1;
+						rank[i] += (d + 1) + sum;
+					}
+					else
+						rank[i] += sum;
+				}
+
+				// barycentric coordinates within the simplex
+				float barycentric[max_d + 2] = { 0 };
+				for (int i = 0; i <= d; i++)
+				{
+					barycentric[d - rank[i]] += (elevated[i] - greedy[i]) / (d + 1);
+					barycentric[d + 1 - rank[i]] -= (elevated[i] - greedy[i]) / (d + 1);
+				}
+				barycentric[0] += 1 + barycentric[d + 1];
+
+				// splat on the simplex vertices
+				for (int remainder = 0; remainder <= d; remainder++)
+				{
+					int key[max_d + 1];
+					for (int i = 0; i < d; i++)
+						key[i] = greedy[i] + canonical[remainder * (d + 1) + rank[i]];
+					int index = lattice.find(key, true);
+					float* val = &lattice.values[index * vd];
+					for (int c = 0; c < vd; c++)
+						val[c] += barycentric[remainder] * value[c];
+					replay_index[size_t(p) * (d + 1) + remainder] = index;
+					replay_weight[size_t(p) * (d + 1) + remainder] = barycentric[remainder];
+				}
+			}
+		}
+
+		// blurring with [1 2 1] / 4 along each lattice direction (lattice points in parallel)
+		const PermutohedralHash & points = lattice;
+		int n_points = points.size();
+		std::vector<float> blurred(lattice.values.size());
+		int n_bands = std::max(1, std::min(cv::getNumThreads(), n_points));
+		for (int j = 0; j <= d; j++)
+		{
+			cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+			{
+				int neighbor1[PermutohedralHash::max_d + 1], neighbor2[PermutohedralHash::max_d + 1];
+				for (int i = bands.start * n_points / n_bands; i < bands.end * n_points / n_bands; i++)
+				{
+					const int* key = points.key(i);
+					for (int k = 0; k < d; k++)
+					{
+						neighbor1[k] = key[k] + 1;
+						neighbor2[k] = key[k] - 1;
+					}
+					if (j < d)
+					{
+						neighbor1[j] = key[j] - d;
+						neighbor2[j] = key[j] + d;
+					}
+					int index1 = points.find(neighbor1);
+					int index2 = points.find(neighbor2);
+					for (int c = 0; c < vd; c++)
+						blurred[i * vd + c] = 0.5f * lattice.values[i * vd + c] +
+							0.25f * (index1 >= 0 ? lattice.values[index1 * vd + c] : 0) +
+							0.25f * (index2 >= 0 ? lattice.values[index2 * vd + c] : 0);
+				}
+			});
+			lattice.values.swap(blurred);
+		}
+
+		// slicing (pixels in parallel)
+		n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows));
+		cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+		{
+			for (int y = bands.start * img.rows / n_bands; y < bands.end * img.rows / n_bands; y++)
+			{
+				const T* yRow = img.ptr<T>(y);
+				T* out_yRow = out_img.ptr<T>(y);
+				for (int x = 0; x < img.cols; x++)
+				{
+					size_t p = size_t(y) * img.cols + x;
+					float value[max_d] = { 0 };
+					for (int remainder = 0; remainder <= d; remainder++)
+					{
+						const float* val = &lattice.values[replay_index[p * (d + 1) + remainder] * vd];
+						float w = replay_weight[p * (d + 1) + remainder];
+						for (int c = 0; c < vd; c++)
+							value[c] += w * val[c];
+					}
+					for (int c = 0; c < cn; c++)
+						out_yRow[x * cn + c] = cv::saturate_cast<T>(value[cn] > 0 ? value[c] / value[cn] : yRow[x * cn + c]);
+				}
+			}
+		});
+	}
+
+	// box means over (2 r + 1) x (2 r + 1) windows (truncated at the image borders) of 'n' features computed
+	// on the fly, for rows [y0, y1) of a 'rows' x 'cols' image
+	// - features(y, row) writes the features of image row y in 'row' (n * cols floats, one feature after the other)
+	// - consume(y, means) receives the means of image row y (same layout)
+	// column sums are updated incrementally (the features of the row entering the window are added, those of
+	// the row leaving it are computed again and subtracted), so neither the cost nor the memory depend on r
+	template <typename Features, typename Consumer>
+	void boxMeansBand(int rows, int cols, int n, int r, int y0, int y1, Features features, Consumer consume)
+	{
+		size_t len = size_t(n) * cols;
+		std::vector<double> col_sums(len, 0.0);
+		std::vector<float> row(len), means(len);
+		auto accumulate = [&](int y, double sign)
+		{
+			features(y, row.data());
+			for (size_t i = 0; i < len; i++)
+				col_sums[i] += sign * row[i];
+		};
+
+		for (int y = std::max(0, y0 - r); y < std::min(rows, y0 + r); y++)
+			accumulate(y, 1);
+		for (int y = y0; y < y1; y++)
+		{
+			if (y + r < rows)
+				accumulate(y + r, 1);
+			if (y > y0 && y - r - 1 >= 0)
+				accumulate(y - r - 1, -1);
+			double n_rows = std::min(rows - 1, y + r) - std::max(0, y - r) + 1;
+			for (int k = 0; k < n; k++)
+			{
+				const double* sums = &col_sums[size_t(k) * cols];
+				float* m = &means[size_t(k) * cols];
+				double s = 0;
+				for (int x = 0; x < std::min(cols, r); x++)
+					s += sums[x];
+				for (int x = 0; x < cols; x++)
+				{
+					if (x + r < cols)
+						s += sums[x + r];
+					if (x - r - 1 >= 0)
+						s -= sums[x - r - 1];
+					double n_cols = std::min(cols - 1, x + r) - std::max(0, x - r) + 1;
+					m[x] = float(s / (n_rows * n_cols));
+				}
+			}
+			consume(y, means.data());
+		}
+	}
+
+	// guided filter output of a row: q_c = sum_k a_ck I_k + b_c, where the coefficients of channel c
+	// are at coeffs[(c * (gc + 1) + k) * kstep + x * xstep] (k = gc for b_c)
+	template <typename T>
+	void guidedCombineRow(const float* guide, int gc, const float* coeffs, size_t kstep, size_t xstep, T* out, int pc, int cols)
+	{
+		for (int x = 0; x < cols; x++)
+			for (int c = 0; c < pc; c++)
+			{
+				const float* coeff = coeffs + size_t(c) * (gc + 1) * kstep + x * xstep;
+				float q = coeff[gc * kstep];
+				for (int k = 0; k < gc; k++)
+					q += coeff[k * kstep] * guide[x * gc + k];
+				out[x * pc + c] = cv::saturate_cast<T>(q);
+			}
+	}
+
+	// guided filter (He, Sun & Tang, 2013) of 'src' (float, pc channels) with 'guide' (float, gc = 1 or 3 channels)
+	// - step 1: local linear coefficients (a_c, b_c) of each channel, stored in 'coeffs' (pc * (gc + 1) channels)
+	// - step 2: box means of the coefficients, either stored in 'mean_coeffs' or, if 'out' is given,
+	//   directly combined with the guide into the output
+	template <typename T>
+	void guidedFilterImpl(const cv::Mat & guide, const cv::Mat & src, int r, float eps, cv::Mat & mean_coeffs, cv::Mat* out)
+	{
+		int rows = guide.rows, cols = guide.cols;
+		int gc = guide.channels(), pc = src.channels();
+		int n_guide = gc + gc * (gc + 1) / 2;	// guide means and second moments
+		int n1 = n_guide + pc * (1 + gc);		// + source means and guide-source moments
+		int n2 = pc * (gc + 1);					// coefficients
+		cv::Mat coeffs(rows, cols, CV_32FC(n2));
+		mean_coeffs.create(rows, cols, CV_32FC(n2));
+		int n_bands = std::max(1, std::min(cv::getNumThreads(), rows / std::max(1, r)));
+
+		// step 1: features are I_k, I_k I_l (k <= l), then for each channel p_c, I_k p_c
+		cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+		{
+			for (int band = bands.start; band < bands.end; band++)
+				boxMeansBand(rows, cols, n1, r, band * rows / n_bands, (band + 1) * rows / n_bands,
+				[&](int y, float* row)
+				{
+					const float* I = guide.ptr<float>(y);
+					const float* p = src.ptr<float>(y);
+					for (int x = 0; x < cols; x++)
+					{
+						int f = 0;
+						for (int k = 0; k < gc; k++)
+							row[f++ * cols + x] = I[x * gc + k];
+						for (int k = 0; k < gc; k++)
+							for (int l = k; l < gc; l++)
+								row[f++ * cols + x] = I[x * gc + k] * I[x * gc + l];
+						for (int c = 0; c < pc; c++)
+						{
+							row[f++ * cols + x] = p[x * pc + c];
+							for (int k = 0; k < gc; k++)
+								row[f++ * cols + x] = I[x * gc + k] * p[x * pc + c];
+						}
+					}
+				},
+				[&](int y, const float* means)
+				{
+					float* coeff = coeffs.ptr<float>(y);
+					for (int x = 0; x < cols; x++, coeff += n2)
+					{
+						// guide mean and regularized covariance (inverted for color guides)
+						float mean_I[3], sigma[3][3], inv[3][3];
+						int f = 0;
+						for (int k = 0; k < gc; k++)
+							mean_I[k] = means[f++ * cols + x];
+						for (int k = 0; k < gc; k++)
+							for (int l = k; l < gc; l++)
+							{
+								sigma[k][l] = sigma[l][k] = means[f++ * cols + x] - mean_I[k] * mean_I[l];
+								if (k == l)
+									sigma[k][k] += eps;
+							}
+						if (gc == 3)
+						{
+							inv[0][0] = sigma[1][1] * sigma[2][2] - sigma[1][2] * sigma[2][1];
+							inv[0][1] = sigma[0][2] * sigma[2][1] - sigma[0][1] * sigma[2][2];
+							inv[0][2] = sigma[0][1] * sigma[1][2] - sigma[0][2] * sigma[1][1];
+							inv[1][1] = sigma[0][0] * sigma[2][2] - sigma[0][2] * sigma[2][0];
+							inv[1][2] = sigma[0][2] * sigma[1][0] - sigma[0][0] * sigma[1][2];
+							inv[2][2] = sigma[0][0] * sigma[1][1] - sigma[0][1] * sigma[1][0];
+							inv[1][0] = inv[0][1];
+							inv[2][0] = inv[0][2];
+							inv[2][1] = inv[1][2];
+							float det = sigma[0][0] * inv[0][0] + sigma[0][1] * inv[1][0] + sigma[0][2] * inv[2][0];
+							for (int k = 0; k < 3; k++)
+								for (int l = 0; l < 3; l++)
+									inv[k][l] /= det;
+						}
+						else
+							inv[0][0] = 1 / sigma[0][0];
+
+						// a_c = sigma^-1 cov(I, p_c), b_c = mean(p_c) - a_c . mean(I)
+						for (int c = 0; c < pc; c++)
+						{
+							float mean_p = means[f++ * cols + x];
+							float cov_Ip[3];
+							for (int k = 0; k < gc; k++)
+								cov_Ip[k] = means[f++ * cols + x] - mean_I[k] * mean_p;
+							float* a = coeff + c * (gc + 1);
+							a[gc] = mean_p;
+							for (int k = 0; k < gc; k++)
+							{
+								a[k] = 0;
+								for (int l = 0; l < gc; l++)
+									a[k] += inv[k][l] * cov_Ip[l];
+								a[gc] -= a[k] * mean_I[k];
+							}
+						}
+					}
+				});
+		});
+
+		// step 2
+		cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+		{
+			for (int band = bands.start; band < bands.end; band++)
+				boxMeansBand(rows, cols, n2, r, band * rows / n_bands, (band + 1) * rows / n_bands,
+				[&](int y, float* row)
+				{
+					const float* coeff = coeffs.ptr<float>(y);
+					for (int x = 0; x < cols; x++)
+						for (int k = 0; k < n2; k++)
+							row[k * cols + x] = coeff[x * n2 + k];
+				},
+				[&](int y, const float* means)
+				{
+					if (out)
+						guidedCombineRow(guide.ptr<float>(y), gc, means, cols, 1, out->ptr<T>(y), pc, cols);
+					else
+					{
+						float* mean_coeff = mean_coeffs.ptr<float>(y);
+						for (int x = 0; x < cols; x++)
+							for (int k = 0; k < n2; k++)
+								mean_coeff[x * n2 + k] = means[k * cols + x];
+					}
+				});
+		});
+	}
+
+	// sum, squared sum and (if 'count' is given) number of mask pixels of the summed-area tables
+	// 'sum', 'sq_sum' ((rows + 1) x (cols + 1), row-major) in [x0, x1) x [y0, y1)
+	template <typename S>
+	inline void summedAreaWindow(const std::vector<S> & sum, const std::vector<S> & sq_sum, const std::vector<int> & count,
+		int cols, int x0, int y0, int x1, int y1, S & s, S & sq, int & n)
+	{
+		size_t stride = cols + 1;
+		size_t a = y0 * stride + x0, b = y0 * stride + x1, c = y1 * stride + x0, d = y1 * stride + x1;
+		s = sum[d] - sum[b] - sum[c] + sum[a];
+		sq = sq_sum[d] - sq_sum[b] - sq_sum[c] + sq_sum[a];
+		n = count.empty() ? (x1 - x0) * (y1 - y0) : count[d] - count[b] - count[c] + count[a];
+	}
+
+	// summed-area tables of 'img' (and of 'mask', if not empty), built in one pass
+	template <typename T, typename S>
+	void summedAreaTables(const cv::Mat & img, const cv::Mat & mask, std::vector<S> & sum, std::vector<S> & sq_sum, std::vector<int> & count)
+	{
+		size_t stride = img.cols + 1;
+		sum.assign(stride * (img.rows + 1), S(0));
+		sq_sum.assign(stride * (img.rows + 1), S(0));
+		if (!mask.empty())
+			count.assign(stride * (img.rows + 1), 0);
+		else
+			count.clear();
+
+		for (int y = 0; y < img.rows; y++)
+		{
+			const T* yRow = img.ptr<T>(y);
+			const unsigned char* mask_yRow = mask.empty() ? 0 : mask.ptr<unsigned char>(y);
+			S row_sum = 0, row_sq_sum = 0;
+			int row_count = 0;
+			size_t i = (y + 1) * stride + 1;
+			for (int x = 0; x < img.cols; x++, i++)
+			{
+				if (!mask_yRow || mask_yRow[x])
+				{
+					S v = S(yRow[x]);
+					row_sum += v;
+					row_sq_sum += v * v;
+					row_count++;
+				}
+				sum[i] = sum[i - stride] + row_sum;
+				sq_sum[i] = sq_sum[i - stride] + row_sq_sum;
+				if (mask_yRow)
+					count[i] = count[i - stride] + row_count;
+			}
+		}
+	}
+
+	// local statistics of rows [y0, y1) from summed-area tables, ksize x ksize windows truncated at the image borders
+	// - stat = -1: mean, variance and standard deviation in 'out' (CV_32FC3)
+	// - stat = 0, 1, 2: only mean, variance or standard deviation in 'out' (CV_32F)
+	template <typename S>
+	void summedAreaStatistics(const std::vector<S> & sum, const std::vector<S> & sq_sum, const std::vector<int> & count,
+		int rows, int cols, int ksize, int stat, cv::Mat & out, int y0, int y1)
+	{
+		for (int y = y0; y < y1; y++)
+		{
+			int wy0 = std::max(0, y - ksize / 2), wy1 = std::min(rows, y - ksize / 2 + ksize);
+			float* out_yRow = out.ptr<float>(y);
+			for (int x = 0; x < cols; x++)
+			{
+				int wx0 = std::max(0, x - ksize / 2), wx1 = std::min(cols, x - ksize / 2 + ksize);
+				S s, sq;
+				int n;
+				summedAreaWindow(sum, sq_sum, count, cols, wx0, wy0, wx1, wy1, s, sq, n);
+				double mean = n ? double(s) / n : 0;
+				double variance = n ? std::max(0.0, (double(sq) - double(s) * mean) / n) : 0;
+				if (stat < 0)
+				{
+					out_yRow[3 * x] = float(mean);
+					out_yRow[3 * x + 1] = float(variance);
+					out_yRow[3 * x + 2] = float(std::sqrt(variance));
+				}
+				else
+					out_yRow[x] = float(stat == 0 ? mean : stat == 1 ? variance : std::sqrt(variance));
+			}
+		}
+	}
+
+	// 3x3 Sobel derivatives of an 8-bit row (rows r0, r1, r2 are the previous, current and next ones)
+	// in 'dx', 'dy', with the given border type along x (as cv::Sobel)
+	// - vertical smoothing [1 2 1] and difference [-1 0 1] in 16-bit integers ('sm', 'df': cols + 2 shorts,
+	//   column x at index x + 1), then horizontal difference and smoothing
+	void sobelRow(const unsigned char* r0, const unsigned char* r1, const unsigned char* r2, int cols, int border,
+		short* sm, short* df, float* dx, float* dy)
+	{
+		int x = 0;
+#if CV_SIMD128
+		for (; x <= cols - 8; x += 8)
+		{
+			cv::v_int16x8 a = cv::v_reinterpret_as_s16(cv::v_load_expand(r0 + x));
+			cv::v_int16x8 b = cv::v_reinterpret_as_s16(cv::v_load_expand(r1 + x));
+			cv::v_int16x8 c = cv::v_reinterpret_as_s16(cv::v_load_expand(r2 + x));
+			cv::v_store(sm + 1 + x, a + b + b + c);
+			cv::v_store(df + 1 + x, c - a);
+		}
+#endif
+		for (; x < cols; x++)
+		{
+			sm[1 + x] = short(r0[x] + 2 * r1[x] + r2[x]);
+			df[1 + x] = short(r2[x] - r0[x]);
+		}
+		sm[0] = sm[1 + cv::borderInterpolate(-1, cols, border)];
+		df[0] = df[1 + cv::borderInterpolate(-1, cols, border)];
+		sm[cols + 1] = sm[1 + cv::borderInterpolate(cols, cols, border)];
+		df[cols + 1] = df[1 + cv::borderInterpolate(cols, cols, border)];
+
+		x = 0;
+#if CV_SIMD128
+		for (; x <= cols - 8; x += 8)
+		{
+			cv::v_int16x8 gx = cv::v_load(sm + x + 2) - cv::v_load(sm + x);
+			cv::v_int16x8 dc = cv::v_load(df + x + 1);
+			cv::v_int16x8 gy = cv::v_load(df + x) + dc + dc + cv::v_load(df + x + 2);
+			cv::v_int32x4 lo, hi;
+			cv::v_expand(gx, lo, hi);
+			cv::v_store(dx + x, cv::v_cvt_f32(lo));
+			cv::v_store(dx + x + 4, cv::v_cvt_f32(hi));
+			cv::v_expand(gy, lo, hi);
+			cv::v_store(dy + x, cv::v_cvt_f32(lo));
+			cv::v_store(dy + x + 4, cv::v_cvt_f32(hi));
+		}
+#endif
+		for (; x < cols; x++)
+		{
+			dx[x] = float(sm[x + 2] - sm[x]);
+			dy[x] = float(df[x] + 2 * df[x + 1] + df[x + 2]);
+		}
+	}
+
+	// coefficients of the polynomial approximation of atan in cv::fastAtan2 (degrees)
+	const float atan_p1 = 0.9997878412794807f * 57.29577951308232f;
+	const float atan_p3 = -0.3258083974640975f * 57.29577951308232f;
+	const float atan_p5 = 0.1555786518463281f * 57.29577951308232f;
+	const float atan_p7 = -0.04432655554792128f * 57.29577951308232f;
+	const float atan_eps = float(std::numeric_limits<double>::epsilon());
+
+	// orientation of (dx, dy) in [0, 360) degrees, as cv::fastAtan2(dy, dx)
+	inline float fastAtan2Deg(float dy, float dx)
+	{
+		float ax = std::abs(dx), ay = std::abs(dy);
+		float c = std::min(ax, ay) / (std::max(ax, ay) + atan_eps);
+		float c2 = c * c;
+		float a = (((atan_p7 * c2 + atan_p5) * c2 + atan_p3) * c2 + atan_p1) * c;
+		if (ax < ay)
+			a = 90.0f - a;
+		if (dx < 0)
+			a = 180.0f - a;
+		if (dy < 0)
+			a = 360.0f - a;
+		return a;
+	}
+
+	// parameters of the fused gradient
+	struct SobelGradientParams
+	{
+		float scale;			// scale of the magnitude
+		float threshold;		// edge threshold on the scaled magnitude (< 0: no edges)
+		int angle_bins;			// orientation bins (0: no orientation)
+		bool angle_filter;		// edges only where the orientation is in [alpha0, alpha1] (wrapped around 360)
+		float alpha0, alpha1;
+	};
+
+	// whether angle 'a' is within the orientation range of 'p'
+	inline bool inAngleRange(float a, const SobelGradientParams & p)
+	{
+		return p.alpha0 <= p.alpha1 ? a >= p.alpha0 && a <= p.alpha1 : a >= p.alpha0 || a <= p.alpha1;
+	}
+
+	// fused gradient of rows [y0, y1): 8-bit magnitude, quantized orientation and edges (if not empty)
+	// from the Sobel derivatives of each row, with all the intermediate data in row buffers
+	void sobelGradientBand(const cv::Mat & img, const SobelGradientParams & p, cv::Mat & mag, cv::Mat & angle, cv::Mat & edges, int y0, int y1)
+	{
+		int cols = img.cols;
+		std::vector<short> sm(cols + 2), df(cols + 2);
+		std::vector<float> dx(cols), dy(cols);
+		bool need_angle = p.angle_bins > 0 || (p.threshold >= 0 && p.angle_filter);
+		float bin_scale = p.angle_bins / 360.0f;
+
+		for (int y = y0; y < y1; y++)
+		{
+			sobelRow(img.ptr<unsigned char>(cv::borderInterpolate(y - 1, img.rows, cv::BORDER_REFLECT_101)), img.ptr<unsigned char>(y),
+				img.ptr<unsigned char>(cv::borderInterpolate(y + 1, img.rows, cv::BORDER_REFLECT_101)), cols, cv::BORDER_REFLECT_101,
+				sm.data(), df.data(), dx.data(), dy.data());
+			unsigned char* mag_yRow = mag.ptr<unsigned char>(y);
+			unsigned char* angle_yRow = angle.empty() ? 0 : angle.ptr<unsigned char>(y);
+			unsigned char* edges_yRow = edges.empty() ? 0 : edges.ptr<unsigned char>(y);
+
+			int x = 0;
+#if CV_SIMD128
+			cv::v_float32x4 v_scale = cv::v_setall_f32(p.scale), v_thresh = cv::v_setall_f32(p.threshold);
+			cv::v_float32x4 v_zero = cv::v_setall_f32(0), v_255 = cv::v_setall_f32(255), v_eps = cv::v_setall_f32(atan_eps);
+			cv::v_float32x4 v_90 = cv::v_setall_f32(90), v_180 = cv::v_setall_f32(180), v_360 = cv::v_setall_f32(360);
+			cv::v_float32x4 v_alpha0 = cv::v_setall_f32(p.alpha0), v_alpha1 = cv::v_setall_f32(p.alpha1);
+			cv::v_float32x4 v_bin_scale = cv::v_setall_f32(bin_scale);
+			cv::v_int32x4 v_last_bin = cv::v_setall_s32(std::max(0, p.angle_bins - 1));
+			for (; x <= cols - 8; x += 8)
+			{
+				cv::v_int32x4 m8[2], a8[2], e8[2];
+				for (int h = 0; h < 2; h++)
+				{
+					cv::v_float32x4 fx = cv::v_load(&dx[x + 4 * h]), fy = cv::v_load(&dy[x + 4 * h]);
+					cv::v_float32x4 m = cv::v_sqrt(cv::v_muladd(fx, fx, fy * fy)) * v_scale;
+					m8[h] = cv::v_round(m);
+					cv::v_float32x4 a = v_zero;
+					if (need_angle)
+					{
+						cv::v_float32x4 ax = cv::v_abs(fx), ay = cv::v_abs(fy);
+						cv::v_float32x4 c = cv::v_min(ax, ay) / (cv::v_max(ax, ay) + v_eps);
+						cv::v_float32x4 c2 = c * c;
+						a = cv::v_muladd(cv::v_muladd(cv::v_muladd(cv::v_setall_f32(atan_p7), c2, cv::v_setall_f32(atan_p5)), c2, cv::v_setall_f32(atan_p3)), c2, cv::v_setall_f32(atan_p1)) * c;
+						a = cv::v_select(ax < ay, v_90 - a, a);
+						a = cv::v_select(fx < v_zero, v_180 - a, a);
+						a = cv::v_select(fy < v_zero, v_360 - a, a);
+						a8[h] = cv::v_min(cv::v_floor(a * v_bin_scale), v_last_bin);
+					}
+					if (edges_yRow)
+					{
+						cv::v_float32x4 edge = m > v_thresh;
+						if (p.angle_filter)
+							edge = edge & (p.alpha0 <= p.alpha1 ? (a >= v_alpha0) & (a <= v_alpha1) : (a >= v_alpha0) | (a <= v_alpha1));
+						e8[h] = cv::v_round(cv::v_select(edge, v_255, v_zero));
+					}
+				}
+				cv::v_pack_u_store(mag_yRow + x, cv::v_pack(m8[0], m8[1]));
+				if (angle_yRow)
+					cv::v_pack_u_store(angle_yRow + x, cv::v_pack(a8[0], a8[1]));
+				if (edges_yRow)
+					cv::v_pack_u_store(edges_yRow + x, cv::v_pack(e8[0], e8[1]));
+			}
+#endif
+			for (; x < cols; x++)
+			{
+				float m = std::sqrt(dx[x] * dx[x] + dy[x] * dy[x]) * p.scale;
+				mag_yRow[x] = cv::saturate_cast<unsigned char>(m);
+				float a = need_angle ? fastAtan2Deg(dy[x], dx[x]) : 0;
+				if (angle_yRow)
+					angle_yRow[x] = (unsigned char)(std::min(int(std::floor(a * bin_scale)), p.angle_bins - 1));
+				if (edges_yRow)
+					edges_yRow[x] = m > p.threshold && (!p.angle_filter || inAngleRange(a, p)) ? 255 : 0;
+			}
+		}
+	}
+
+	// maximum gradient magnitude of rows [y0, y1)
+	float sobelMaxMagnitudeBand(const cv::Mat & img, int y0, int y1)
+	{
+		int cols = img.cols;
+		std::vector<short> sm(cols + 2), df(cols + 2);
+		std::vector<float> dx(cols), dy(cols);
+		float max_sq = 0;
+		for (int y = y0; y < y1; y++)
+		{
+			sobelRow(img.ptr<unsigned char>(cv::borderInterpolate(y - 1, img.rows, cv::BORDER_REFLECT_101)), img.ptr<unsigned char>(y),
+				img.ptr<unsigned char>(cv::borderInterpolate(y + 1, img.rows, cv::BORDER_REFLECT_101)), cols, cv::BORDER_REFLECT_101,
+				sm.data(), df.data(), dx.data(), dy.data());
+			int x = 0;
+#if CV_SIMD128
+			cv::v_float32x4 v_max_sq = cv::v_setall_f32(0);
+			for (; x <= cols - 4; x += 4)
+			{
+				cv::v_float32x4 fx = cv::v_load(&dx[x]), fy = cv::v_load(&dy[x]);
+				v_max_sq = cv::v_max(v_max_sq, cv::v_muladd(fx, fx, fy * fy));
+			}
+			float lanes[4];
+			cv::v_store(lanes, v_max_sq);
+			max_sq = std::max(max_sq, std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3])));
+#endif
+			for (; x < cols; x++)
+				max_sq = std::max(max_sq, dx[x] * dx[x] + dy[x] * dy[x]);
+		}
+		return std::sqrt(max_sq);
+	}
+
+	// zero crossings of rows [y0, y1) (1 <= y0, y1 <= rows - 1) of a float response, columns [1, cols - 1):
+	// each of the 4 pairs of opposite neighbors is tested with masks (opposite signs and absolute difference
+	// >= threshold), and the 4 tests are or-ed, without branches
+	void zeroCrossingsBand(const cv::Mat & response, float threshold, cv::Mat & out_img, int y0, int y1)
+	{
+		int cols = response.cols;
+		for (int y = y0; y < y1; y++)
+		{
+			const float* prev = response.ptr<float>(y - 1);
+			const float* curr = response.ptr<float>(y);
+			const float* next = response.ptr<float>(y + 1);
+			unsigned char* out_yRow = out_img.ptr<unsigned char>(y);
+
+			int x = 1;
+#if CV_SIMD128
+			cv::v_float32x4 v_zero = cv::v_setall_f32(0), v_255 = cv::v_setall_f32(255), v_thresh = cv::v_setall_f32(threshold);
+			for (; x <= cols - 1 - 8; x += 8)
+			{
+				cv::v_int32x4 crossing[2];
+				for (int h = 0; h < 2; h++)
+				{
+					int i = x + 4 * h;
+					// opposite pairs: N-S, W-E, NE-SW, NW-SE
+					cv::v_float32x4 a[4] = { cv::v_load(prev + i), cv::v_load(curr + i - 1), cv::v_load(prev + i + 1), cv::v_load(prev + i - 1) };
+					cv::v_float32x4 b[4] = { cv::v_load(next + i), cv::v_load(curr + i + 1), cv::v_load(next + i - 1), cv::v_load(next + i + 1) };
+					cv::v_float32x4 mask = v_zero < v_zero;
+					for (int k = 0; k < 4; k++)
+					{
+						cv::v_float32x4 opposite = ((a[k] < v_zero) & (b[k] > v_zero)) | ((a[k] > v_zero) & (b[k] < v_zero));
+						mask = mask | (opposite & (cv::v_abs(a[k] - b[k]) >= v_thresh));
+					}
+					crossing[h] = cv::v_round(cv::v_select(mask, v_255, v_zero));
+				}
+				cv::v_pack_u_store(out_yRow + x, cv::v_pack(crossing[0], crossing[1]));
+			}
+#endif
+			for (; x < cols - 1; x++)
+			{
+				float a[4] = { prev[x], curr[x - 1], prev[x + 1], prev[x - 1] };
+				float b[4] = { next[x], curr[x + 1], next[x - 1], next[x + 1] };
+				bool crossing = false;
+				for (int k = 0; k < 4; k++)
+					crossing |= ((a[k] < 0 && b[k] > 0) || (a[k] > 0 && b[k] < 0)) && std::abs(a[k] - b[k]) >= threshold;
+				out_yRow[x] = crossing ? 255 : 0;
+			}
+		}
+	}
+
+	// rows [ys0, ys1) of 'img' (8-bit) blurred with the separable 'kernel' (BORDER_REPLICATE) in 'out' (ys1 - ys0 rows)
+	void gaussianRows(const cv::Mat & img, const cv::Mat & kernel, int ys0, int ys1, cv::Mat & out)
+	{
+		int cols = img.cols;
+		int ksize = kernel.rows;
+		int r = ksize / 2;
+		const float* w = kernel.ptr<float>();
+
+		// ring of horizontally smoothed rows (row y is stored in slot (y - ys0 + r) % ksize)
+		std::vector<float> ring(ksize * cols), padded(cols + 2 * r), blurred(cols);
+		auto smoothRow = [&](int y)
+		{
+			const unsigned char* yRow = img.ptr<unsigned char>(cv::borderInterpolate(y, img.rows, cv::BORDER_REPLICATE));
+			for (int x = -r; x < cols + r; x++)
+				padded[x + r] = yRow[cv::borderInterpolate(x, cols, cv::BORDER_REPLICATE)];
+			float* dst = &ring[((y - ys0 + r) % ksize) * cols];
+			std::fill(dst, dst + cols, 0.0f);
+			for (int k = 0; k < ksize; k++)
+				accumulateScaled(dst, &padded[k], w[k], cols);
+		};
+
+		for (int y = ys0 - r; y < ys0 + r; y++)
+			smoothRow(y);
+		for (int y = ys0; y < ys1; y++)
+		{
+			smoothRow(y + r);
+			std::fill(blurred.begin(), blurred.end(), 0.0f);
+			for (int k = 0; k < ksize; k++)
+				accumulateScaled(blurred.data(), &ring[((y + k - ys0) % ksize) * cols], w[k], cols);
+			unsigned char* out_yRow = out.ptr<unsigned char>(y - ys0);
+			for (int x = 0; x < cols; x++)
+				out_yRow[x] = cv::saturate_cast<unsigned char>(blurred[x]);
+		}
+	}
+
+	// Canny candidates of rows [y0, y1): smoothing (if 'kernel' is not empty), Sobel derivatives and
+	// non-maximum suppression as in cv::Canny (BORDER_REPLICATE, same sector tests and ties), with
+	// 'map' = 2 (local maxima above 'high'), 1 (local maxima above 'low') or 0
+	void cannyCandidatesBand(const cv::Mat & img, const cv::Mat & kernel, int low, int high, bool L2, cv::Mat & map, int y0, int y1)
+	{
+		const int shift = 15;
+		const int tg22 = int(0.4142135623730950488016887242097 * (1 << shift) + 0.5);
+		int rows = img.rows, cols = img.cols;
+
+		// smoothed rows [ys0, ys1): the band, plus two rows above and below for derivatives and suppression
+		int ys0 = std::max(0, y0 - 2), ys1 = std::min(rows, y1 + 2);
+		cv::Mat smoothed;
+		if (!kernel.empty())
+		{
+			smoothed.create(ys1 - ys0, cols, CV_8U);
+			gaussianRows(img, kernel, ys0, ys1, smoothed);
+		}
+		auto row = [&](int y)
+		{
+			y = cv::borderInterpolate(y, rows, cv::BORDER_REPLICATE);
+			return kernel.empty() ? img.ptr<unsigned char>(y) : smoothed.ptr<unsigned char>(y - ys0);
+		};
+
+		// ring of 3 magnitude rows (zero-padded, as outside the image) with their derivatives
+		std::vector<short> sm(cols + 2), df(cols + 2);
+		std::vector<float> dxf(cols), dyf(cols);
+		std::vector<int> mag(3 * (cols + 2), 0);
+		std::vector<short> dx(3 * cols), dy(3 * cols);
+		auto magnitudeRow = [&](int y)
+		{
+			int slot = (y - y0 + 3) % 3;
+			int* m = &mag[slot * (cols + 2)] + 1;
+			if (y < 0 || y >= rows)
+			{
+				std::fill(m, m + cols, 0);
+				return;
+			}
+			sobelRow(row(y - 1), row(y), row(y + 1), cols, cv::BORDER_REPLICATE, sm.data(), df.data(), dxf.data(), dyf.data());
+			short* dx_row = &dx[slot * cols];
+			short* dy_row = &dy[slot * cols];
+			for (int x = 0; x < cols; x++)
+			{
+				dx_row[x] = short(dxf[x]);
+				dy_row[x] = short(dyf[x]);
+				m[x] = L2 ? dx_row[x] * dx_row[x] + dy_row[x] * dy_row[x] : std::abs(dx_row[x]) + std::abs(dy_row[x]);
+			}
+		};
+
+		magnitudeRow(y0 - 1);
+		magnitudeRow(y0);
+		for (int y = y0; y < y1; y++)
+		{
+			magnitudeRow(y + 1);
+			const int* m_p = &mag[((y - 1 - y0 + 3) % 3) * (cols + 2)] + 1;
+			const int* m_c = &mag[((y - y0 + 3) % 3) * (cols + 2)] + 1;
+			const int* m_n = &mag[((y + 1 - y0 + 3) % 3) * (cols + 2)] + 1;
+			const short* dx_row = &dx[((y - y0 + 3) % 3) * cols];
+			const short* dy_row = &dy[((y - y0 + 3) % 3) * cols];
+			unsigned char* map_yRow = map.ptr<unsigned char>(y);
+			for (int x = 0; x < cols; x++)
+			{
+				int m = m_c[x];
+				bool local_max = false;
+				if (m > low)
+				{
+					int xs = dx_row[x], ys = dy_row[x];
+					int ax = std::abs(xs), ay = std::abs(ys) << shift;
+					int tg22x = ax * tg22;
+					if (ay < tg22x)
+						local_max = m > m_c[x - 1] && m >= m_c[x + 1];
+					else
+					{
+						int tg67x = tg22x + (ax << (shift + 1));
+						if (ay > tg67x)
+							local_max = m > m_p[x] && m >= m_n[x];
+						else
+						{
+							int s = (xs ^ ys) < 0 ? -1 : 1;
+							local_max = m > m_p[x - s] && m > m_n[x + s];
+						}
+					}
+				}
+				map_yRow[x] = local_max ? (m > high ? 2 : 1) : 0;
+			}
+		}
+	}
+
+	// union-find root of p, with path halving (each node on the path is linked to its grandparent)
+	inline int findRoot(std::vector<int> & parent, int p)
+	{
+		while (parent[p] != p)
+			p = parent[p] = parent[parent[p]];
+		return p;
+	}
+
+	// same as above, without path halving (read-only, so it can be called concurrently)
+	inline int findRootShared(const std::vector<int> & parent, int p)
+	{
+		while (parent[p] != p)
+			p = parent[p];
+		return p;
+	}
+
+	// merge the components of p and q (the smallest root becomes the root of both)
+	inline void uniteRoots(std::vector<int> & parent, std::vector<unsigned char> & strong, int p, int q)
+	{
+		p = findRoot(parent, p);
+		q = findRoot(parent, q);
+		if (p == q)
+			return;
+		if (p > q)
+			std::swap(p, q);
+		parent[q] = p;
+		strong[p] |= strong[q];
+	}
+
+	// 8-connected components of the Canny candidates of rows [y0, y1), using only pixels of the band:
+	// each candidate ends up pointing directly to its band-local root, which is 'strong' if the component
+	// contains a strong candidate
+	void cannyComponentsBand(const cv::Mat & map, std::vector<int> & parent, std::vector<unsigned char> & strong, int y0, int y1)
+	{
+		int cols = map.cols;
+		for (int y = y0; y < y1; y++)
+		{
+			const unsigned char* map_yRow = map.ptr<unsigned char>(y);
+			const unsigned char* map_prevRow = y > y0 ? map.ptr<unsigned char>(y - 1) : 0;
+			for (int x = 0; x < cols; x++)
+			{
+				if (!map_yRow[x])
+					continue;
+				int p = y * cols + x;
+				parent[p] = p;
+				strong[p] = map_yRow[x] == 2;
+				if (x > 0 && map_yRow[x - 1])
+					uniteRoots(parent, strong, p, p - 1);
+				if (map_prevRow)
+					for (int dx = -1; dx <= 1; dx++)
+						if (x + dx >= 0 && x + dx < cols && map_prevRow[x + dx])
+							uniteRoots(parent, strong, p, p - cols + dx);
+			}
+		}
+
+		// flatten
+		for (int y = y0; y < y1; y++)
+		{
+			const unsigned char* map_yRow = map.ptr<unsigned char>(y);
+			for (int x = 0; x < cols; x++)
+				if (map_yRow[x])
+					parent[y * cols + x] = findRoot(parent, y * cols + x);
+		}
+	}
+
+	// update the running maximum 'mag_max' (and its index 'arg_max') of one channel (of 'cn') of a row with the
+	// magnitudes of the complex 'response' (re, im pairs) of orientation k
+	void gaborReduceRow(const float* response, int cols, int k, float* mag_max, unsigned char* arg_max, int cn)
+	{
+		for (int x = 0; x < cols; x++)
+		{
+			float re = response[2 * x], im = response[2 * x + 1];
+			float m = std::sqrt(re * re + im * im);
+			if (m > mag_max[x * cn])
+			{
+				mag_max[x * cn] = m;
+				arg_max[x * cn] = (unsigned char)k;
+			}
+		}
+	}
+
+	// out[i] = max(a[i], b[i]) (dilate) or min(a[i], b[i]) (erode) for 8-bit, 16-bit and float elements
+	template <bool dilate, typename T>
+	void extremumRows(const T* a, const T* b, T* out, int n)
+	{
+		int i = 0;
+#if CV_SIMD128
+		typedef decltype(cv::v_load(a)) vec;
+		for (; i <= n - vec::nlanes; i += vec::nlanes)
+		{
+			vec va = cv::v_load(a + i), vb = cv::v_load(b + i);
+			cv::v_store(out + i, dilate ? cv::v_max(va, vb) : cv::v_min(va, vb));
+		}
+#endif
+		for (; i < n; i++)
+			out[i] = dilate ? std::max(a[i], b[i]) : std::min(a[i], b[i]);
+	}
+
+	// van Herk/Gil-Werman running max (min) over windows of 'k' pixels of a row of 'cols' pixels with 'cn'
+	// interleaved channels: dst[x] = extremum of src[x - anchor, x - anchor + k), ignoring pixels outside the row
+	// - 'e', 'g', 'h': buffers of (cols + k - 1) * cn elements for the padded row and the prefix (g) and
+	//   suffix (h) extrema within blocks of k pixels, so that each window is the union of a suffix and a prefix
+	template <bool dilate, typename T>
+	void vanHerkRow(const T* src, T* dst, int cols, int cn, int k, int anchor, T* e, T* g, T* h)
+	{
+		const T identity = dilate ? std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max();
+		int n = (cols + k - 1) * cn;
+		std::fill(e, e + n, identity);
+		std::copy(src, src + cols * cn, e + anchor * cn);
+
+		for (int b = 0; b < n; b += k * cn)
+		{
+			int b_end = std::min(n, b + k * cn);
+			for (int i = b; i < b + cn; i++)
+				g[i] = e[i];
+			for (int i = b + cn; i < b_end; i++)
+				g[i] = dilate ? std::max(g[i - cn], e[i]) : std::min(g[i - cn], e[i]);
+			for (int i = b_end - cn; i < b_end; i++)
+				h[i] = e[i];
+			for (int i = b_end - cn - 1; i >= b; i--)
+				h[i] = dilate ? std::max(h[i + cn], e[i]) : std::min(h[i + cn], e[i]);
+		}
+		extremumRows<dilate>(h, g + (k - 1) * cn, dst, cols * cn);
+	}
+
+	// rectangular erosion/dilation of rows [y0, y1) as cv::erode/cv::dilate with a MORPH_RECT 'ksize' element
+	// (default anchor and border), separable: van Herk/Gil-Werman along each row, then along each column
+	// on whole rows (vectorized), where rows are grouped in blocks of ksize.height
+	template <bool dilate, typename T>
+	void morphRectBand(const cv::Mat & img, cv::Mat & out_img, cv::Size ksize, int y0, int y1)
+	{
+		const T identity = dilate ? std::numeric_limits<T>::lowest() : std::numeric_limits<T>::max();
+		int cn = img.channels();
+		int n = img.cols * cn;
+		int k = ksize.height, anchor = ksize.height / 2;
+
+		// horizontal pass on the rows y0 - anchor + i, i in [0, n_rows) (rows outside the image are 'identity')
+		int n_rows = y1 - y0 + k - 1;
+		std::vector<T> e(size_t(n_rows) * n), g(size_t(n_rows) * n), h(size_t(n_rows) * n);
+		std::vector<T> row_e((img.cols + ksize.width - 1) * cn), row_g(row_e.size()), row_h(row_e.size());
+		for (int i = 0; i < n_rows; i++)
+		{
+			int y = y0 - anchor + i;
+			T* e_row = &e[size_t(i) * n];
+			if (y < 0 || y >= img.rows)
+				std::fill(e_row, e_row + n, identity);
+			else if (ksize.width == 1)
+				std::copy(img.ptr<T>(y), img.ptr<T>(y) + n, e_row);
+			else
+				vanHerkRow<dilate>(img.ptr<T>(y), e_row, img.cols, cn, ksize.width, ksize.width / 2,
+					row_e.data(), row_g.data(), row_h.data());
+		}
+
+		// vertical pass
+		for (int b = 0; b < n_rows; b += k)
+		{
+			int b_end = std::min(n_rows, b + k);
+			std::copy(&e[size_t(b) * n], &e[size_t(b + 1) * n], &g[size_t(b) * n]);
+			for (int i = b + 1; i < b_end; i++)
+				extremumRows<dilate>(&g[size_t(i - 1) * n], &e[size_t(i) * n], &g[size_t(i) * n], n);
+			std::copy(&e[size_t(b_end - 1) * n], &e[size_t(b_end) * n], &h[size_t(b_end - 1) * n]);
+			for (int i = b_end - 2; i >= b; i--)
+				extremumRows<dilate>(&h[size_t(i + 1) * n], &e[size_t(i) * n], &h[size_t(i) * n], n);
+		}
+		for (int y = y0; y < y1; y++)
+			extremumRows<dilate>(&h[size_t(y - y0) * n], &g[size_t(y - y0 + k - 1) * n], out_img.ptr<T>(y), n);
+	}
+
+	template <bool dilate>
+	cv::Mat morphRect(const cv::Mat & img, cv::Size ksize)
+	{
+		cv::Mat out_img(img.rows, img.cols, img.type());
+		int n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows / std::max(8, ksize.height)));
+		cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+		{
+			for (int band = bands.start; band < bands.end; band++)
+			{
+				int y0 = band * img.rows / n_bands, y1 = (band + 1) * img.rows / n_bands;
+				if (img.depth() == CV_8U)
+					morphRectBand<dilate, unsigned char>(img, out_img, ksize, y0, y1);
+				else if (img.depth() == CV_16U)
+					morphRectBand<dilate, unsigned short>(img, out_img, ksize, y0, y1);
+				else
+					morphRectBand<dilate, float>(img, out_img, ksize, y0, y1);
+			}
+		});
+		return out_img;
+	}
+
+	// periodic line structuring element {i * v, i = -m, ..., m}
+	struct PeriodicLine
+	{
+		cv::Point v;	// period
+		int m;			// number of periods on each side of the origin
+	};
+
+	// periodic lines whose Minkowski sum (a 16-sided zonotope, filled thanks to the horizontal and vertical
+	// lines) approximates the 'ksize' ellipse: half-lengths fitted by least squares to the support function
+	// of the ellipse (its extent along each direction), then rounded and refined on integers
+	// - mirrored directions share the same half-length, so that the approximation has the symmetries of the ellipse
+	std::vector<PeriodicLine> ellipseLines(cv::Size ksize)
+	{
+		std::vector<PeriodicLine> lines = { {cv::Point(1, 0), 0}, {cv::Point(0, 1), 0}, {cv::Point(1, 1), 0}, {cv::Point(1, -1), 0},
+			{cv::Point(2, 1), 0}, {cv::Point(2, -1), 0}, {cv::Point(1, 2), 0}, {cv::Point(1, -2), 0} };
+		const int group[] = { 0, 1, 2, 2, 3, 3, 4, 4 };		// half-length of each line
+		const int n = 5;									// number of half-lengths
+		const int min_m[n] = { 1, 1, 0, 0, 0 };				// horizontal and vertical lines must be present
+		double a = (ksize.width - 1) / 2.0, b = (ksize.height - 1) / 2.0;
+
+		// extent of the lines of each group (per period) and of the ellipse along directions in [0, pi)
+		const int n_angles = 180;
+		std::vector<double> A(n_angles * n, 0), t(n_angles);
+		for (int j = 0; j < n_angles; j++)
+		{
+			double c = std::cos(j * CV_PI / n_angles), s = std::sin(j * CV_PI / n_angles);
+			t[j] = std::sqrt(a * a * c * c + b * b * s * s);
+			for (size_t i = 0; i < lines.size(); i++)
+				A[j * n + group[i]] += std::abs(lines[i].v.x * c + lines[i].v.y * s);
+		}
+		auto error = [&](const std::vector<double> & m)
+		{
+			double e = 0;
+			for (int j = 0; j < n_angles; j++)
+			{
+				double r = -t[j];
+				for (int i = 0; i < n; i++)
+					r += A[j * n + i] * m[i];
+				e += r * r;
+			}
+			return e;
+		};
+
+		// nonnegative least squares by coordinate descent
+		std::vector<double> m(n, 0);
+		for (int iter = 0; iter < 200; iter++)
+			for (int i = 0; i < n; i++)
+			{
+				double num = 0, den = 0;
+				for (int j = 0; j < n_angles; j++)
+				{
+					double r = t[j];
+					for (int k = 0; k < n; k++)
+						if (k != i)
+							r -= A[j * n + k] * m[k];
+					num += A[j * n + i] * r;
+					den += A[j * n + i] * A[j * n + i];
+				}
+				m[i] = std::max(0.0, num / den);
+			}
+
+		// integer half-lengths: rounding, then single steps while the error decreases
+		for (int i = 0; i < n; i++)
+			m[i] = std::max(double(min_m[i]), std::round(m[i]));
+		for (bool improved = true; improved; )
+		{
+			improved = false;
+			for (int i = 0; i < n; i++)
+				for (int step = -1; step <= 1; step += 2)
+				{
+					std::vector<double> m_step = m;
+					m_step[i] += step;
+					if (m_step[i] >= min_m[i] && error(m_step) < error(m) - 1e-9)
+					{
+						m = m_step;
+						improved = true;
+					}
+				}
+		}
+		for (size_t i = 0; i < lines.size(); i++)
+			lines[i].m = int(m[group[i]]);
+		return lines;
+	}
+
+	// erosion/dilation with a periodic line (v.y > 0) of the chains of pixels p, p + v, p + 2v, ... starting
+	// from starts[s], s in [s0, s1) (van Herk/Gil-Werman along each chain, pixels outside the image are ignored)
+	template <bool dilate, typename T>
+	void periodicLineChains(const cv::Mat & img, cv::Mat & out_img, const PeriodicLine & line,
+		const std::vector<cv::Point> & starts, int s0, int s1)
+	{
+		int cn = img.channels();
+		int k = 2 * line.m + 1;
+		int max_len = std::max(img.rows, img.cols);
+		std::vector<T> chain(max_len * cn), out_chain(max_len * cn);
+		std::vector<T> e((max_len + k - 1) * cn), g(e.size()), h(e.size());
+		for (int s = s0; s < s1; s++)
+		{
+			int len = 0;
+			for (cv::Point p = starts[s]; p.x >= 0 && p.x < img.cols && p.y < img.rows; p += line.v, len++)
+				std::copy(img.ptr<T>(p.y) + p.x * cn, img.ptr<T>(p.y) + (p.x + 1) * cn, &chain[len * cn]);
+			vanHerkRow<dilate>(chain.data(), out_chain.data(), len, cn, k, line.m, e.data(), g.data(), h.data());
+			len = 0;
+			for (cv::Point p = starts[s]; p.x >= 0 && p.x < img.cols && p.y < img.rows; p += line.v, len++)
+				std::copy(&out_chain[len * cn], &out_chain[(len + 1) * cn], out_img.ptr<T>(p.y) + p.x * cn);
+		}
+	}
+
+	template <bool dilate>
+	cv::Mat morphPeriodicLine(const cv::Mat & img, const PeriodicLine & line)
+	{
+		// first pixels of the chains, i.e. those whose predecessor p - v is outside the image (with v.y > 0)
+		cv::Point v = line.v.y < 0 ? -line.v : line.v;
+		std::vector<cv::Point> starts;
+		for (int y = 0; y < img.rows; y++)
+		{
+			int x0 = 0, x1 = img.cols;
+			if (y >= v.y && v.x > 0)
+				x1 = std::min(v.x, img.cols);
+			else if (y >= v.y)
+				x0 = std::max(0, img.cols + v.x);
+			for (int x = x0; x < x1; x++)
+				starts.push_back(cv::Point(x, y));
+		}
+		PeriodicLine chain_line = { v, line.m };
+
+		cv::Mat out_img(img.rows, img.cols, img.type());
+		int n_bands = std::max(1, std::min(cv::getNumThreads(), int(starts.size())));
+		cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+		{
+			for (int band = bands.start; band < bands.end; band++)
+			{
+				int s0 = int(band * starts.size() / n_bands), s1 = int((band + 1) * starts.size() / n_bands);
+				if (img.depth() == CV_8U)
+					periodicLineChains<dilate, unsigned char>(img, out_img, chain_line, starts, s0, s1);
+				else if (img.depth() == CV_16U)
+					periodicLineChains<dilate, unsigned short>(img, out_img, chain_line, starts, s0, s1);
+				else
+					periodicLineChains<dilate, float>(img, out_img, chain_line, starts, s0, s1);
+			}
+		});
+		return out_img;
+	}
+
+	// erosion/dilation with the periodic line decomposition of an ellipse: the image is padded with the
+	// identity of the operation by the extent of the decomposition, so that the intermediate results
+	// near the image borders are complete and the composition equals a single pass with the whole element
+	template <bool dilate>
+	cv::Mat morphEllipse(const cv::Mat & img, const std::vector<PeriodicLine> & lines)
+	{
+		int rx = 0, ry = 0;
+		for (size_t i = 0; i < lines.size(); i++)
+		{
+			rx += lines[i].m * std::abs(lines[i].v.x);
+			ry += lines[i].m * std::abs(lines[i].v.y);
+		}
+		double identity = dilate ? (img.depth() == CV_32F ? -double(std::numeric_limits<float>::max()) : 0.0) :
+			(img.depth() == CV_8U ? 255.0 : img.depth() == CV_16U ? 65535.0 : double(std::numeric_limits<float>::max()));
+		cv::Mat padded;
+		cv::copyMakeBorder(img, padded, ry, ry, rx, rx, cv::BORDER_CONSTANT, cv::Scalar::all(identity));
+
+		// horizontal and vertical lines (the first two) together as a rectangle
+		padded = morphRect<dilate>(padded, cv::Size(2 * lines[0].m + 1, 2 * lines[1].m + 1));
+		for (size_t i = 2; i < lines.size(); i++)
+			if (lines[i].m > 0)
+				padded = morphPeriodicLine<dilate>(padded, lines[i]);
+		return padded(cv::Rect(rx, ry, img.cols, img.rows)).clone();
+	}
+
+	// erosions and dilations ('morph') composed into the operation 'op' as in cv::morphologyEx
+	cv::Mat morphologyCompose(const cv::Mat & img, int op, const std::function<cv::Mat(const cv::Mat &, bool)> & morph, const char* name)
+	{
+		if (op == cv::MORPH_ERODE)
+			return morph(img, false);
+		else if (op == cv::MORPH_DILATE)
+			return morph(img, true);
+		else if (op == cv::MORPH_OPEN)
+			return morph(morph(img, false), true);
+		else if (op == cv::MORPH_CLOSE)
+			return morph(morph(img, true), false);
+
+		// differences (saturated, as cv::morphologyEx)
+		cv::Mat out_img;
+		if (op == cv::MORPH_GRADIENT)
+			cv::subtract(morph(img, true), morph(img, false), out_img);
+		else if (op == cv::MORPH_TOPHAT)
+			cv::subtract(img, morph(morph(img, false), true), out_img);
+		else if (op == cv::MORPH_BLACKHAT)
+			cv::subtract(morph(morph(img, true), false), img, out_img);
+		else
+			throw aia::error(aia::strprintf("%s: unsupported operation %d", name, op));
+		return out_img;
+	}
+
+	// image of the same size of 'img' with its border pixels (zero elsewhere), e.g. as reconstruction marker
+	cv::Mat borderMarker(const cv::Mat & img)
+	{
+		cv::Mat marker(img.rows, img.cols, img.type(), cv::Scalar::all(0));
+		img.row(0).copyTo(marker.row(0));
+		img.row(img.rows - 1).copyTo(marker.row(img.rows - 1));
+		img.col(0).copyTo(marker.col(0));
+		img.col(img.cols - 1).copyTo(marker.col(img.cols - 1));
+		return marker;
+	}
+
+	// grayscale reconstruction by dilation of a single-channel 'marker' under 'mask' in 'out_img'
+	// (Vincent's hybrid algorithm): a forward and a backward raster scan propagate values along
+	// the scan directions, and the pixels that could still propagate them backwards seed a FIFO
+	// that completes the reconstruction (it ends when the queue is empty: no convergence tests)
+	template <typename T>
+	void reconstructGrayscaleChannel(const cv::Mat & marker, const cv::Mat & mask, cv::Mat & out_img, int connectivity)
+	{
+		// marker (J) and mask (I) with a 1-pixel frame of lowest values, which never propagate
+		// and are never updated since there J = I
+		const T lowest = std::numeric_limits<T>::lowest();
+		int rows = mask.rows, cols = mask.cols;
+		int stride = cols + 2;
+		std::vector<T> J(size_t(rows + 2) * stride, lowest), I(J.size(), lowest);
+		for (int y = 0; y < rows; y++)
+		{
+			const T* marker_yRow = marker.ptr<T>(y);
+			const T* mask_yRow = mask.ptr<T>(y);
+			size_t p = size_t(y + 1) * stride + 1;
+			for (int x = 0; x < cols; x++, p++)
+			{
+				I[p] = mask_yRow[x];
+				J[p] = std::min(marker_yRow[x], mask_yRow[x]);
+			}
+		}
+
+		// neighbors already scanned by the forward (backward) scan: the first 2 are the 4-connected ones
+		const int n = connectivity / 2;
+		const int forward[] = { -1, -stride, -stride - 1, -stride + 1 };
+		const int backward[] = { 1, stride, stride + 1, stride - 1 };
+
+		for (int y = 1; y <= rows; y++)
+			for (int p = y * stride + 1; p <= y * stride + cols; p++)
+			{
+				T v = J[p];
+				for (int k = 0; k < n; k++)
+					v = std::max(v, J[p + forward[k]]);
+				J[p] = std::min(v, I[p]);
+			}
+
+		std::vector<int> fifo;
+		for (int y = rows; y >= 1; y--)
+			for (int p = y * stride + cols; p >= y * stride + 1; p--)
+			{
+				T v = J[p];
+				for (int k = 0; k < n; k++)
+					v = std::max(v, J[p + backward[k]]);
+				J[p] = v = std::min(v, I[p]);
+				for (int k = 0; k < n; k++)
+				{
+					int q = p + backward[k];
+					if (J[q] < v && J[q] < I[q])
+					{
+						fifo.push_back(p);
+						break;
+					}
+				}
+			}
+
+		for (size_t head = 0; head < fifo.size(); head++)
+		{
+			int p = fifo[head];
+			for (int k = 0; k < 2 * n; k++)
+			{
+				int q = p + (k < n ? forward[k] : backward[k - n]);
+				if (J[q] < J[p] && J[q] != I[q])
+				{
+					J[q] = std::min(J[p], I[q]);
+					fifo.push_back(q);
+				}
+			}
+		}
+
+		for (int y = 0; y < rows; y++)
+			std::copy(&J[size_t(y + 1) * stride + 1], &J[size_t(y + 1) * stride + 1 + cols], out_img.ptr<T>(y));
+	}
+
+	// valid bits of the last word of a packed row of 'cols' pixels
+	inline uint64_t lastWordMask(int cols)
+	{
+		return cols % 64 ? (uint64_t(1) << (cols % 64)) - 1 : ~uint64_t(0);
+	}
+
+	// word i of a packed row ('n' words) shifted by 's' pixels: bit b of the result is pixel 64 * i + b + s
+	// of the row, pixels outside the 'n' words are read from 'fill'
+	inline uint64_t shiftedWord(const uint64_t* row, int n, int i, int s, uint64_t fill)
+	{
+		int q = s >= 0 ? s / 64 : -((63 - s) / 64);		// floor(s / 64)
+		int r = s - 64 * q;
+		int j = i + q;
+		uint64_t lo = j >= 0 && j < n ? row[j] : fill;
+		if (r == 0)
+			return lo;
+		uint64_t hi = j + 1 >= 0 && j + 1 < n ? row[j + 1] : fill;
+		return (lo >> r) | (hi << (64 - r));
+	}
+
+	// OR of the 'length' pixels starting (forward) or ending (backward) at each pixel of a packed row
+	// ('n' words, 0 outside), accumulated into 'out'; runs of doubling length are built in place in 'run'
+	// by shifting and ORing whole words, and the ones that sum up to 'length' are ORed with increasing
+	// offsets, so the cost is O(log length) word operations per word
+	void accumulateRuns(const uint64_t* row, int n, int length, bool forward, uint64_t* run, uint64_t* out)
+	{
+		std::copy(row, row + n, run);
+		int sign = forward ? 1 : -1;
+		int offset = 0;
+		for (int len = 1; length > 0; len *= 2, length /= 2)
+		{
+			if (length & 1)
+			{
+				for (int i = 0; i < n; i++)
+					out[i] |= shiftedWord(run, n, i, sign * offset, 0);
+				offset += len;
+			}
+
+			// run(x) |= run(x + len): words are updated in the opposite order to the one they are read from
+			if (length > 1)
+			{
+				if (forward)
+					for (int i = 0; i < n; i++)
+						run[i] |= shiftedWord(run, n, i, len, 0);
+				else
+					for (int i = n - 1; i >= 0; i--)
+						run[i] |= shiftedWord(run, n, i, -len, 0);
+			}
+		}
+	}
+
+	// pack an 8-bit row (nonzero = 1) into the (zeroed) words of 'dst'
+	void packRow(const unsigned char* src, int cols, uint64_t* dst)
+	{
+		int x = 0;
+#if CV_SIMD128
+		cv::v_uint8x16 zero = cv::v_setzero_u8();
+		for (; x <= cols - 64; x += 64)
+		{
+			uint64_t word = 0;
+			for (int k = 0; k < 4; k++)
+				word |= uint64_t(unsigned(cv::v_signmask(cv::v_load(src + x + 16 * k) != zero))) << (16 * k);
+			dst[x / 64] = word;
+		}
+#endif
+		for (; x < cols; x++)
+			if (src[x])
+				dst[x / 64] |= uint64_t(1) << (x % 64);
+	}
+
+	// 0/255 pixels of each byte value (bit k = pixel k)
+	struct ByteExpansion
+	{
+		unsigned char pixels[256][8];
+
+		ByteExpansion()
+		{
+			for (int b = 0; b < 256; b++)
+				for (int k = 0; k < 8; k++)
+					pixels[b][k] = (b >> k) & 1 ? 255 : 0;
+		}
+	};
+
+	// unpack a packed row to 8-bit 0/255 pixels, 8 at a time
+	void unpackRow(const uint64_t* src, int cols, unsigned char* dst)
+	{
+		static const ByteExpansion table;
+		int x = 0;
+		for (; x <= cols - 8; x += 8)
+			std::memcpy(dst + x, table.pixels[(src[x / 64] >> (x % 64)) & 255], 8);
+		for (; x < cols; x++)
+			dst[x] = (src[x / 64] >> (x % 64)) & 1 ? 255 : 0;
+	}
+
+	// table walk of rows [y0, y1): four independent lookups per iteration
+	// (with histogram of the output if 'histo' is given)
+	template <typename Tin, typename Tout>
+	void applyLUTBand(const cv::Mat & src, const cv::Mat & lut, cv::Mat & dst, int y0, int y1, int* histo)
+	{
+		const Tout* table = lut.ptr<Tout>();
+		int len = src.cols * src.channels();
+		for (int y = y0; y < y1; y++)
+		{
+			const Tin* src_yRow = src.ptr<Tin>(y);
+			Tout* dst_yRow = dst.ptr<Tout>(y);
+			int x = 0;
+			for (; x <= len - 4; x += 4)
+			{
+				Tout v0 = table[src_yRow[x]];
+				Tout v1 = table[src_yRow[x + 1]];
+				Tout v2 = table[src_yRow[x + 2]];
+				Tout v3 = table[src_yRow[x + 3]];
+				dst_yRow[x] = v0;
+				dst_yRow[x + 1] = v1;
+				dst_yRow[x + 2] = v2;
+				dst_yRow[x + 3] = v3;
+				if (histo)
+				{
+					histo[v0]++;
+					histo[v1]++;
+					histo[v2]++;
+					histo[v3]++;
+				}
+			}
+			for (; x < len; x++)
+			{
+				dst_yRow[x] = table[src_yRow[x]];
+				if (histo)
+					histo[dst_yRow[x]]++;
+			}
+		}
+	}
+
+	// parallel table walk over row bands, with optional histogram of the output
+	// (each band counts on its own histogram, which are summed at the end)
+	template <typename Tin, typename Tout>
+	void applyLUTParallel(const cv::Mat & src, const cv::Mat & lut, cv::Mat & dst, std::vector<int>* histo)
+	{
+		int n_bands = std::max(1, std::min(cv::getNumThreads(), src.rows));
+		int n_bins = 1 << (8 * sizeof(Tout));
+		std::vector<std::vector<int> > band_histo(histo ? n_bands : 0, std::vector<int>(n_bins, 0));
+		cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+		{
+			for (int band = bands.start; band < bands.end; band++)
+				applyLUTBand<Tin, Tout>(src, lut, dst, band * src.rows / n_bands, (band + 1) * src.rows / n_bands,
+					histo ? band_histo[band].data() : 0);
+		});
+
+		if (histo)
+		{
+			histo->assign(n_bins, 0);
+			for (int band = 0; band < n_bands; band++)
+				for (int i = 0; i < n_bins; i++)
+					(*histo)[i] += band_histo[band][i];
+		}
+	}
+
+	// apply 'lut' to 'src' (with optional histogram of the output)
+	void applyLUTImpl(const cv::Mat & src, const cv::Mat & lut, cv::Mat & dst, std::vector<int>* histo)
+	{
+		// precondition checks
+		if (src.depth() != CV_8U && src.depth() != CV_16U)
+			throw aia::error("applyLUT: only 8- and 16-bit images are supported");
+		if (lut.total() != (src.depth() == CV_8U ? 256 : 65536) || lut.channels() != 1 || !lut.isContinuous())
+			throw aia::error("applyLUT: LUT size does not match image depth");
+		if (lut.depth() != CV_8U && lut.depth() != CV_16U)
+			throw aia::error("applyLUT: only 8- and 16-bit LUTs are supported");
+
+		// 'src' and 'dst' can be the same image: the output is allocated on a separate header, so that
+		// when the type changes the source data stays alive until the table walk is done
+		cv::Mat out = dst;
+		out.create(src.rows, src.cols, CV_MAKETYPE(lut.depth(), src.channels()));
+
+		if (src.depth() == CV_8U && lut.depth() == CV_8U)
+			applyLUTParallel<unsigned char, unsigned char>(src, lut, out, histo);
+		else if (src.depth() == CV_8U)
+			applyLUTParallel<unsigned char, unsigned short>(src, lut, out, histo);
+		else if (lut.depth() == CV_8U)
+			applyLUTParallel<unsigned short, unsigned char>(src, lut, out, histo);
+		else
+			applyLUTParallel<unsigned short, unsigned short>(src, lut, out, histo);
+		dst = out;
+	}
+
+	// default number of gray levels
+	inline int grayLevels(int depth, int L)
+	{
+		return L > 0 ? L : (depth == CV_8U ? 256 : 65536);
+	}
+}
+
+cv::Mat aia::medianHistogram(const cv::Mat & img, int k)
+{
+	// precondition checks
+	if (img.depth() != CV_8U)
+		throw aia::error("medianHistogram: only 8-bit images are supported");
+	if (k < 1 || k % 2 == 0)
+		throw aia::error(aia::strprintf("medianHistogram: kernel size must be odd and positive (found %d)", k));
+	if (k == 1)
+		return img.clone();
+
+	cv::Mat out_img(img.rows, img.cols, img.type());
+
+	// split the image into horizontal bands that are processed in parallel:
+	// each band has to initialize its column histograms with k rows, hence
+	// we avoid bands that are thinner than the kernel
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows / k));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int band = bands.start; band < bands.end; band++)
+			medianHistogramBand(img, out_img, k, band * img.rows / n_bands, (band + 1) * img.rows / n_bands);
+	});
+
+	return out_img;
+}
+
+cv::Mat aia::medianHistogram16(const cv::Mat & img, int k)
+{
+	// precondition checks
+	if (img.depth() != CV_16U)
+		throw aia::error("medianHistogram16: only 16-bit images are supported");
+	if (k < 1 || k % 2 == 0)
+		throw aia::error(aia::strprintf("medianHistogram16: kernel size must be odd and positive (found %d)", k));
+	if (k == 1)
+		return img.clone();
+
+	cv::Mat out_img(img.rows, img.cols, img.type());
+
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows / k));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int band = bands.start; band < bands.end; band++)
+			medianHistogram16Band(img, out_img, k, band * img.rows / n_bands, (band + 1) * img.rows / n_bands);
+	});
+
+	return out_img;
+}
+
+cv::Mat aia::median(const cv::Mat & img, int k)
+{
+	// precondition checks
+	if (k < 1 || k % 2 == 0)
+		throw aia::error(aia::strprintf("median: kernel size must be odd and positive (found %d)", k));
+	if (k == 1)
+		return img.clone();
+
+	// 16-bit images: OpenCV supports only k <= 5
+	if (img.depth() == CV_16U && k > 5)
+		return medianHistogram16(img, k);
+
+	if (img.depth() != CV_8U)
+	{
+		cv::Mat out_img;
+		cv::medianBlur(img, out_img, k);
+		return out_img;
+	}
+
+	// large windows: histogram method
+	if (k > 7)
+		return medianHistogram(img, k);
+
+	// small windows: median networks are built only once
+	static const MedianNetwork networks[] = { MedianNetwork(3), MedianNetwork(5), MedianNetwork(7) };
+	const MedianNetwork & net = networks[k / 2 - 1];
+
+	// use the widest SIMD registers this file is compiled for: the instruction set is a compile-time
+	// choice (CV_SIMD256 / CV_SIMD512 need AVX2 / AVX-512 enabled for the whole build), while
+	// cv::setUseOptimized(false) selects the scalar networks at runtime
+	cv::Mat out_img(img.rows, img.cols, img.type());
+	if (cv::useOptimized())
+	{
+#if CV_SIMD512
+		medianNetwork<Simd512Ops>(img, out_img, net);
+		return out_img;
+#elif CV_SIMD256
+		medianNetwork<Simd256Ops>(img, out_img, net);
+		return out_img;
+#elif CV_SIMD128
+		medianNetwork<Simd128Ops>(img, out_img, net);
+		return out_img;
+#endif
+	}
+	medianNetwork<ScalarOps>(img, out_img, net);
+	return out_img;
+}
+
+cv::Mat aia::medianAdaptive(const cv::Mat & img, int k_max, ImpulseDetection detection, int outlier_threshold, AdaptiveMedianStats* stats)
+{
+	// precondition checks
+	if (img.type() != CV_8U)
+		throw aia::error("medianAdaptive: only 8-bit grayscale images are supported");
+	if (k_max < 3 || k_max % 2 == 0)
+		throw aia::error(aia::strprintf("medianAdaptive: maximum kernel size must be odd and >= 3 (found %d)", k_max));
+
+	// detect impulse candidates
+	cv::Mat candidates;
+	if (detection == IMPULSE_EXTREMES)
+		candidates = (img == 0) | (img == 255);
+	else
+	{
+		cv::Mat img_min, img_max, img_diff;
+		cv::erode(img, img_min, cv::Mat());
+		cv::dilate(img, img_max, cv::Mat());
+		cv::absdiff(img, median(img, 3), img_diff);
+		candidates = ((img == img_min) | (img == img_max)) & (img_diff > outlier_threshold);
+	}
+
+	// clean pixels are left untouched, candidates are resolved in parallel row bands
+	cv::Mat out_img = img.clone();
+	int n_sizes = k_max / 2;
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows));
+	std::vector<std::vector<int> > band_processed(n_bands, std::vector<int>(n_sizes + 1, 0));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		std::vector<unsigned char> clean, all;
+		for (int band = bands.start; band < bands.end; band++)
+			for (int y = band * img.rows / n_bands; y < (band + 1) * img.rows / n_bands; y++)
+			{
+				const unsigned char* candidates_yRow = candidates.ptr(y);
+				unsigned char* out_yRow = out_img.ptr(y);
+				for (int x = 0; x < img.cols; x++)
+					if (candidates_yRow[x])
+					{
+						int size_idx = resolveImpulse(img, candidates, y, x, k_max, clean, all, out_yRow[x]);
+						band_processed[band][size_idx < 0 ? n_sizes : size_idx]++;
+					}
+			}
+	});
+
+	if (stats)
+	{
+		stats->processed.assign(n_sizes, 0);
+		stats->unresolved = 0;
+		for (int band = 0; band < n_bands; band++)
+		{
+			for (int i = 0; i < n_sizes; i++)
+				stats->processed[i] += band_processed[band][i];
+			stats->unresolved += band_processed[band][n_sizes];
+		}
+		stats->candidates = stats->unresolved;
+		for (int i = 0; i < n_sizes; i++)
+			stats->candidates += stats->processed[i];
+	}
+
+	return out_img;
+}
+
+std::vector<int> aia::histogram(const cv::Mat & img, int L)
+{
+	return histogramImpl(img, cv::Mat(), L);
+}
+
+std::vector<int> aia::histogram_mask(const cv::Mat & img, const cv::Mat & mask, int L)
+{
+	return histogramImpl(img, mask, L);
+}
+
+void HistogramEqualizer::setImage(const cv::Mat & _img, int _L)
+{
+	// precondition checks
+	if (_img.channels() != 1 && _img.channels() != 3)
+		throw aia::error(aia::strprintf("HistogramEqualizer: image has %d channels, only 1- and 3-channel images are supported", _img.channels()));
+	if (_img.depth() != CV_8U && _img.depth() != CV_16U)
+		throw aia::error("HistogramEqualizer: only 8- and 16-bit images are supported");
+
+	img = _img;
+	L = grayLevels(img.depth(), _L);
+
+	// equalization is applied on the luminance channel only: for color images,
+	// we extract it with a colorspace conversion (Lab here, but HSV is also a valid option)
+	planes.clear();
+	if (img.channels() == 3)
+	{
+		cv::Mat img_Lab;
+		cv::cvtColor(img, img_Lab, cv::COLOR_BGR2Lab);
+		cv::split(img_Lab, planes);
+	}
+	else
+		planes.push_back(img);
+
+	// invalidate all cached results
+	global_lut.release();
+	global_lum.release();
+	global_result.release();
+	tile_histos.release();
+	tile_luts.release();
+	adaptive_result.release();
+}
+
+cv::Mat HistogramEqualizer::compose(const cv::Mat & lum) const
+{
+	if (img.channels() == 1)
+		return lum;
+
+	std::vector<cv::Mat> out_planes = planes;
+	out_planes[0] = lum;
+	cv::Mat out_img;
+	cv::merge(out_planes, out_img);
+	cv::cvtColor(out_img, out_img, cv::COLOR_Lab2BGR);
+	return out_img;
+}
+
+cv::Mat HistogramEqualizer::equalize()
+{
+	if (global_result.empty())
+	{
+		// histogram, cumulative distribution function and LUT only depend on the image
+		if (global_lut.empty())
+		{
+			std::vector<int> histo = histogram(planes[0], L);
+			std::vector<int> cdf(histo.size());
+			int acc = 0;
+			for (size_t i = 0; i < histo.size(); i++)
+			{
+				acc += histo[i];
+				cdf[i] = acc;
+			}
+
+			float left_term = float(L - 1) / planes[0].total();
+			int max_level = L - 1;
+			global_lut = pointLUT(img.depth(), img.depth(), [&](double r)
+			{
+				return std::floor(left_term * cdf[std::min(int(r), max_level)]);
+			});
+		}
+
+		// the histogram of the result is counted in the same pass
+		applyLUT(planes[0], global_lut, global_lum, global_histo);
+		global_result = compose(global_lum);
+	}
+
+	last_lum = global_lum;
+	last_adaptive = false;
+	return global_result;
+}
+
+cv::Mat HistogramEqualizer::equalizeAdaptive(cv::Size grid, double clip)
+{
+	const cv::Mat & lum = planes[0];
+	ClaheGrid g(lum.size(), grid, L, std::min(L, 4096));
+
+	// tile histograms only depend on the tile grid
+	if (tile_histos.empty() || g.grid != tiles_grid)
+	{
+		tile_histos.release();
+		tile_luts.release();
+		tiles_grid = g.grid;
+		n_bins = g.n_bins;
+	}
+
+	// tile LUTs also depend on the clip limit
+	if (tile_luts.empty() || clip != clip_limit)
+	{
+		tile_luts.release();
+		clip_limit = clip;
+		adaptive_result.release();
+	}
+
+	if (adaptive_result.empty())
+	{
+		claheImpl(lum, adaptive_lum, g, clip_limit, tile_histos, tile_luts);
+		adaptive_result = compose(adaptive_lum);
+		adaptive_histo = histogram(adaptive_lum);
+	}
+
+	last_lum = adaptive_lum;
+	last_adaptive = true;
+	return adaptive_result;
+}
+
+cv::Mat aia::clahe(const cv::Mat & img, double clip, cv::Size grid, int L, int n_bins)
+{
+	// precondition checks
+	if (img.channels() != 1)
+		throw aia::error(aia::strprintf("clahe: image has %d channels, only single-channel images are supported", img.channels()));
+	if (img.depth() != CV_8U && img.depth() != CV_16U)
+		throw aia::error("clahe: only 8- and 16-bit images are supported");
+	L = grayLevels(img.depth(), L);
+	n_bins = n_bins > 0 ? n_bins : std::min(L, 4096);
+	if ((L & (L - 1)) || (n_bins & (n_bins - 1)) || L > (img.depth() == CV_8U ? 256 : 65536))
+		throw aia::error(aia::strprintf("clahe: gray levels (%d) and bins (%d) must be powers of 2 within the image depth", L, n_bins));
+
+	cv::Mat out_img, histos, luts;
+	claheImpl(img, out_img, ClaheGrid(img.size(), grid, L, n_bins), clip, histos, luts);
+	return out_img;
+}
+
+cv::Mat aia::colorValue(const cv::Mat & img)
+{
+	// precondition checks
+	if (img.channels() != 3)
+		throw aia::error(aia::strprintf("colorValue: image has %d channels, only 3-channel images are supported", img.channels()));
+	if (img.depth() != CV_8U && img.depth() != CV_16U)
+		throw aia::error("colorValue: only 8- and 16-bit images are supported");
+
+	cv::Mat value(img.rows, img.cols, CV_MAKETYPE(img.depth(), 1));
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int band = bands.start; band < bands.end; band++)
+		{
+			int y0 = band * img.rows / n_bands, y1 = (band + 1) * img.rows / n_bands;
+			if (img.depth() == CV_8U)
+				colorValueBand<unsigned char>(img, value, y0, y1);
+			else
+				colorValueBand<unsigned short>(img, value, y0, y1);
+		}
+	});
+
+	return value;
+}
+
+cv::Mat aia::applyValueGain(const cv::Mat & img, const cv::Mat & value, const cv::Mat & value_eq)
+{
+	// precondition checks
+	if (img.channels() != 3 || (img.depth() != CV_8U && img.depth() != CV_16U))
+		throw aia::error("applyValueGain: only 3-channel 8- and 16-bit images are supported");
+	if (value.size() != img.size() || value_eq.size() != img.size() ||
+		value.type() != CV_MAKETYPE(img.depth(), 1) || value_eq.type() != value.type())
+		throw aia::error("applyValueGain: value planes must be single-channel images with the same size and depth of the image");
+
+	// reciprocal of every value, so that the gain costs one multiplication
+	std::vector<float> inv_value(img.depth() == CV_8U ? 256 : 65536, 0.0f);
+	for (size_t v = 1; v < inv_value.size(); v++)
+		inv_value[v] = 1.0f / v;
+
+	cv::Mat out_img(img.rows, img.cols, img.type());
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int band = bands.start; band < bands.end; band++)
+		{
+			int y0 = band * img.rows / n_bands, y1 = (band + 1) * img.rows / n_bands;
+			if (img.depth() == CV_8U)
+				valueGainBand<unsigned char>(img, value, value_eq, inv_value, out_img, y0, y1);
+			else
+				valueGainBand<unsigned short>(img, value, value_eq, inv_value, out_img, y0, y1);
+		}
+	});
+
+	return out_img;
+}
+
+cv::Mat aia::pointLUT(int in_depth, int out_depth, const std::function<double(double)> & f)
+{
+	// precondition checks
+	if ((in_depth != CV_8U && in_depth != CV_16U) || (out_depth != CV_8U && out_depth != CV_16U))
+		throw aia::error("pointLUT: only 8- and 16-bit LUTs are supported");
+
+	cv::Mat lut(1, in_depth == CV_8U ? 256 : 65536, out_depth);
+	for (int r = 0; r < lut.cols; r++)
+		if (out_depth == CV_8U)
+			lut.at<unsigned char>(r) = cv::saturate_cast<unsigned char>(f(r));
+		else
+			lut.at<unsigned short>(r) = cv::saturate_cast<unsigned short>(f(r));
+	return lut;
+}
+
+cv::Mat aia::gammaLUT(int depth, double gamma, int L)
+{
+	L = grayLevels(depth, L);
+	double c = std::pow(L - 1, 1 - gamma);
+	return pointLUT(depth, depth, [c, gamma](double r) { return c * std::pow(r, gamma); });
+}
+
+cv::Mat aia::logLUT(int depth, int L)
+{
+	L = grayLevels(depth, L);
+	double c = (L - 1) / std::log(L);
+	return pointLUT(depth, depth, [c](double r) { return c * std::log(1 + r); });
+}
+
+cv::Mat aia::piecewiseLinearLUT(int depth, const std::vector<cv::Point2f> & points)
+{
+	if (points.empty())
+		throw aia::error("piecewiseLinearLUT: at least one point is required");
+
+	return pointLUT(depth, depth, [&points](double r)
+	{
+		if (r <= points.front().x)
+			return double(points.front().y);
+		for (size_t i = 1; i < points.size(); i++)
+			if (r <= points[i].x)
+				return points[i - 1].y + (r - points[i - 1].x) * (points[i].y - points[i - 1].y) / (points[i].x - points[i - 1].x);
+		return double(points.back().y);
+	});
+}
+
+void aia::applyLUT(const cv::Mat & src, const cv::Mat & lut, cv::Mat & dst)
+{
+	applyLUTImpl(src, lut, dst, 0);
+}
+
+void aia::applyLUT(const cv::Mat & src, const cv::Mat & lut, cv::Mat & dst, std::vector<int> & histo)
+{
+	applyLUTImpl(src, lut, dst, &histo);
+}
+
+PointPipeline::PointPipeline(int _depth, int _L)
+{
+	if (_depth != CV_8U && _depth != CV_16U)
+		throw aia::error("PointPipeline: only 8- and 16-bit images are supported");
+
+	depth = _depth;
+	L = grayLevels(depth, _L);
+	lut = pointLUT(depth, depth, [](double r) { return r; });
+}
+
+PointPipeline & PointPipeline::then(const cv::Mat & step_lut)
+{
+	// lut(r) <-- step_lut(lut(r)), which is just 'step_lut' applied to the 'lut' image
+	applyLUT(lut, step_lut, lut);
+	return *this;
+}
+
+PointPipeline & PointPipeline::then(const std::function<double(double)> & f)
+{
+	return then(pointLUT(depth, depth, f));
+}
+
+PointPipeline & PointPipeline::log()
+{
+	return then(logLUT(depth, L));
+}
+
+PointPipeline & PointPipeline::gamma(double gamma)
+{
+	return then(gammaLUT(depth, gamma, L));
+}
+
+PointPipeline & PointPipeline::invert()
+{
+	int max_level = L - 1;
+	return then([max_level](double r) { return max_level - r; });
+}
+
+PointPipeline & PointPipeline::stretch(double r_min, double r_max)
+{
+	return then(piecewiseLinearLUT(depth, { cv::Point2f(r_min, 0), cv::Point2f(r_max, L - 1) }));
+}
+
+PointPipeline & PointPipeline::piecewiseLinear(const std::vector<cv::Point2f> & points)
+{
+	return then(piecewiseLinearLUT(depth, points));
+}
+
+void PointPipeline::apply(const cv::Mat & src, cv::Mat & dst) const
+{
+	applyLUT(src, lut, dst);
+}
+
+void PointPipeline::apply(const cv::Mat & src, cv::Mat & dst, std::vector<int> & histo) const
+{
+	applyLUT(src, lut, dst, histo);
+}
+
+cv::Mat aia::imhist(const std::vector<int> & histo, int height)
+{
+	// precondition checks
+	if (histo.empty())
+		throw aia::error("imhist: empty histogram");
+
+	// group bins so that there are at most 256 bars
+	int group = std::max(1, int(histo.size() + 255) / 256);
+	std::vector<int> bars((histo.size() + group - 1) / group, 0);
+	for (size_t i = 0; i < histo.size(); i++)
+		bars[i / group] += histo[i];
+	int max_bar = std::max(1, *std::max_element(bars.begin(), bars.end()));
+
+	// draw bars (2 pixels wide) from the bottom of the plot
+	cv::Mat plot(height, 2 * int(bars.size()), CV_8U, cv::Scalar(255));
+	for (size_t i = 0; i < bars.size(); i++)
+	{
+		int bar_height = cvRound(double(bars[i]) * (height - 1) / max_bar);
+		if (bar_height > 0)
+			plot(cv::Rect(2 * int(i), height - bar_height, 2, bar_height)).setTo(cv::Scalar(0));
+	}
+
+	return plot;
+}
+
+cv::Mat aia::gaussianRecursive(const cv::Mat & img, double sigma_x, double sigma_y)
+{
+	// precondition checks
+	if (img.depth() != CV_8U && img.depth() != CV_16U && img.depth() != CV_32F)
+		throw aia::error("gaussianRecursive: only 8-bit, 16-bit and float images are supported");
+	if (sigma_y <= 0)
+		sigma_y = sigma_x;
+	if (sigma_x < 0.5 || sigma_y < 0.5)
+		throw aia::error(aia::strprintf("gaussianRecursive: sigma must be >= 0.5 (found %.2f, %.2f)", sigma_x, sigma_y));
+
+	cv::Mat buf;
+	img.convertTo(buf, CV_MAKETYPE(CV_64F, img.channels()));
+	int cn = img.channels();
+	int n_elems = img.cols * cn;
+
+	// rows: parallel bands, each channel is filtered separately
+	RecursiveGaussian g_x(sigma_x);
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int band = bands.start; band < bands.end; band++)
+			for (int y = band * img.rows / n_bands; y < (band + 1) * img.rows / n_bands; y++)
+				for (int c = 0; c < cn; c++)
+					recursiveGaussianLine(buf.ptr<double>(y) + c, img.cols, cn, g_x);
+	});
+
+	// columns: parallel strips (not too narrow, so that the row-by-row sweep stays vectorizable)
+	RecursiveGaussian g_y(sigma_y);
+	int n_strips = std::max(1, std::min(cv::getNumThreads(), n_elems / 16));
+	cv::parallel_for_(cv::Range(0, n_strips), [&](const cv::Range & strips)
+	{
+		for (int strip = strips.start; strip < strips.end; strip++)
+			recursiveGaussianColumns(buf, strip * n_elems / n_strips, (strip + 1) * n_elems / n_strips, g_y);
+	});
+
+	cv::Mat out_img;
+	buf.convertTo(out_img, img.type());
+	return out_img;
+}
+
+cv::Mat aia::gaussianBlur(const cv::Mat & img, double sigma_x, double sigma_y, double sigma_iir)
+{
+	if (sigma_y <= 0)
+		sigma_y = sigma_x;
+	if (sigma_x >= sigma_iir && sigma_y >= sigma_iir && (img.depth() == CV_8U || img.depth() == CV_16U || img.depth() == CV_32F))
+		return gaussianRecursive(img, sigma_x, sigma_y);
+
+	cv::Mat out_img;
+	cv::GaussianBlur(img, out_img, cv::Size(0, 0), sigma_x, sigma_y, cv::BORDER_REPLICATE);
+	return out_img;
+}
+
+cv::Mat aia::unsharpMask(const cv::Mat & img, double sigma, double amount, double threshold)
+{
+	return unsharpMask(img, sigma, cv::Scalar::all(amount), threshold);
+}
+
+cv::Mat aia::unsharpMask(const cv::Mat & img, double sigma, const cv::Scalar & amounts, double threshold)
+{
+	// precondition checks
+	if (img.depth() != CV_8U && img.depth() != CV_16U && img.depth() != CV_32F)
+		throw aia::error("unsharpMask: only 8-bit, 16-bit and float images are supported");
+	if (img.channels() > 4)
+		throw aia::error(aia::strprintf("unsharpMask: image has %d channels, at most 4 are supported", img.channels()));
+	if (sigma <= 0)
+		throw aia::error(aia::strprintf("unsharpMask: sigma must be positive (found %.2f)", sigma));
+
+	// same kernel size as cv::GaussianBlur on 8-bit images
+	cv::Mat kernel = cv::getGaussianKernel(cvRound(sigma * 6 + 1) | 1, sigma, CV_32F);
+
+	cv::Mat out_img(img.rows, img.cols, img.type());
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows / kernel.rows));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int band = bands.start; band < bands.end; band++)
+		{
+			int y0 = band * img.rows / n_bands, y1 = (band + 1) * img.rows / n_bands;
+			if (img.depth() == CV_8U)
+				unsharpMaskBand<unsigned char>(img, out_img, kernel, amounts, float(threshold), y0, y1);
+			else if (img.depth() == CV_16U)
+				unsharpMaskBand<unsigned short>(img, out_img, kernel, amounts, float(threshold), y0, y1);
+			else
+				unsharpMaskBand<float>(img, out_img, kernel, amounts, float(threshold), y0, y1);
+		}
+	});
+
+	return out_img;
+}
+
+GaussianScaleSpace::GaussianScaleSpace(int _levels_per_octave, size_t _max_bytes)
+	: levels_per_octave(std::max(1, _levels_per_octave)), max_bytes(_max_bytes), clock(0), n_hits(0), n_misses(0)
+{
+}
+
+void GaussianScaleSpace::setImage(const cv::Mat & _img)
+{
+	img = _img;
+	levels.clear();
+	n_hits = n_misses = 0;
+}
+
+size_t GaussianScaleSpace::levelBytes(const Level & level)
+{
+	size_t bytes = level.work.total() * level.work.elemSize();
+	if (level.img.data != level.work.data)
+		bytes += level.img.total() * level.img.elemSize();
+	return bytes;
+}
+
+size_t GaussianScaleSpace::memory() const
+{
+	size_t bytes = 0;
+	for (const Level & level : levels)
+		bytes += levelBytes(level);
+	return bytes;
+}
+
+GaussianScaleSpace::Level* GaussianScaleSpace::closestBelow(double sigma)
+{
+	Level* closest = 0;
+	for (Level & level : levels)
+		if (level.sigma <= sigma && (!closest || level.sigma > closest->sigma))
+			closest = &level;
+	return closest;
+}
+
+GaussianScaleSpace::Level & GaussianScaleSpace::build(double sigma)
+{
+	// incremental blur from the closest cached image below (or from the source image)
+	Level* base = closestBelow(sigma);
+	double base_sigma = base ? base->sigma : 0;
+	cv::Mat base_img = base ? base->work : img;
+	if (!base && img.depth() < CV_32F)
+		img.convertTo(base_img, CV_32F);
+	Level level = { sigma, gaussianBlur(base_img, std::sqrt(sigma * sigma - base_sigma * base_sigma)), cv::Mat(), clock };
+
+	// round integer images only on return, so that the next incremental blurs start from the float level
+	if (img.depth() < CV_32F)
+		level.work.convertTo(level.img, img.depth());
+	else
+		level.img = level.work;
+
+	// make room by discarding the least recently used images
+	size_t bytes = levelBytes(level);
+	size_t used = memory();
+	while (!levels.empty() && used + bytes > max_bytes)
+	{
+		std::vector<Level>::iterator lru = levels.begin();
+		for (std::vector<Level>::iterator it = levels.begin(); it != levels.end(); it++)
+			if (it->last_use < lru->last_use)
+				lru = it;
+		used -= levelBytes(*lru);
+		levels.erase(lru);
+	}
+
+	levels.push_back(level);
+	return levels.back();
+}
+
+GaussianScaleSpace::Level & GaussianScaleSpace::level(double sigma)
+{
+	clock++;
+
+	// cached image
+	for (Level & level : levels)
+		if (std::abs(level.sigma - sigma) < 1e-6)
+		{
+			level.last_use = clock;
+			n_hits++;
+			return level;
+		}
+	n_misses++;
+
+	// build the grid level below 'sigma' first (if it is not cached and it is closer than any cached image),
+	// so that it can serve as a base for the next requests
+	double grid_sigma = std::pow(2.0, std::floor(levels_per_octave * std::log2(sigma) + 1e-9) / levels_per_octave);
+	Level* base = closestBelow(sigma);
+	if (grid_sigma >= 0.5 && sigma - grid_sigma > 1e-6 && (!base || grid_sigma - base->sigma > 1e-6))
+		build(grid_sigma);
+
+	return build(sigma);
+}
+
+cv::Mat GaussianScaleSpace::blur(double sigma)
+{
+	if (sigma <= 0)
+		return img;
+	return level(sigma).img;
+}
+
+cv::Mat GaussianScaleSpace::differenceOfGaussians(double sigma)
+{
+	if (sigma <= 0)
+		throw aia::error(aia::strprintf("GaussianScaleSpace: DoG sigma must be positive (found %.2f)", sigma));
+
+	// adjacent grid levels: both are cached and shared by the DoGs of the neighboring scales
+	double k = std::pow(2.0, 1.0 / levels_per_octave);
+	cv::Mat fine = level(sigma).work;
+	cv::Mat coarse = level(k * sigma).work;
+	cv::Mat dog;
+	cv::subtract(coarse, fine, dog, cv::noArray(), CV_32F);
+	dog *= 1.0 / (k - 1);
+	return dog;
+}
+
+cv::Mat aia::bilateralGrid(const cv::Mat & img, double sigma_color, double sigma_space)
+{
+	// precondition checks
+	if (img.channels() != 1)
+		throw aia::error(aia::strprintf("bilateralGrid: single-channel image expected, found %d channels", img.channels()));
+	if (img.depth() != CV_8U && img.depth() != CV_16U && img.depth() != CV_32F)
+		throw aia::error("bilateralGrid: only 8-bit, 16-bit and float images are supported");
+	if (sigma_color <= 0 || sigma_space <= 0)
+		throw aia::error(aia::strprintf("bilateralGrid: sigmas must be positive (found %.2f, %.2f)", sigma_color, sigma_space));
+
+	cv::Mat out_img(img.rows, img.cols, img.type());
+	if (img.depth() == CV_8U)
+		bilateralGridImpl<unsigned char>(img, out_img, sigma_color, sigma_space);
+	else if (img.depth() == CV_16U)
+		bilateralGridImpl<unsigned short>(img, out_img, sigma_color, sigma_space);
+	else
+		bilateralGridImpl<float>(img, out_img, sigma_color, sigma_space);
+	return out_img;
+}
+
+cv::Mat aia::bilateralPermutohedral(const cv::Mat & img, double sigma_color, double sigma_space)
+{
+	// precondition checks
+	if (img.channels() != 1 && img.channels() != 3)
+		throw aia::error(aia::strprintf("bilateralPermutohedral: 1- or 3-channel image expected, found %d channels", img.channels()));
+	if (img.depth() != CV_8U && img.depth() != CV_16U && img.depth() != CV_32F)
+		throw aia::error("bilateralPermutohedral: only 8-bit, 16-bit and float images are supported");
+	if (sigma_color <= 0 || sigma_space <= 0)
+		throw aia::error(aia::strprintf("bilateralPermutohedral: sigmas must be positive (found %.2f, %.2f)", sigma_color, sigma_space));
+
+	cv::Mat out_img(img.rows, img.cols, img.type());
+	if (img.depth() == CV_8U)
+		bilateralPermutohedralImpl<unsigned char>(img, out_img, sigma_color, sigma_space);
+	else if (img.depth() == CV_16U)
+		bilateralPermutohedralImpl<unsigned short>(img, out_img, sigma_color, sigma_space);
+	else
+		bilateralPermutohedralImpl<float>(img, out_img, sigma_color, sigma_space);
+	return out_img;
+}
+
+cv::Mat aia::bilateral(const cv::Mat & img, double sigma_color, double sigma_space, double sigma_space_exact)
+{
+	// same as cv::bilateralFilter
+	if (sigma_color <= 0)
+		sigma_color = 1;
+	if (sigma_space <= 0)
+		sigma_space = 1;
+
+	// small kernels: the exact filter is fast enough (and more accurate)
+	bool supported = img.depth() == CV_8U || img.depth() == CV_16U || img.depth() == CV_32F;
+	if (sigma_space < sigma_space_exact || !supported || (img.channels() != 1 && img.channels() != 3))
+	{
+		cv::Mat out_img;
+		cv::bilateralFilter(img, out_img, 0, sigma_color, sigma_space);
+		return out_img;
+	}
+
+	// the grid is too large for fine range sigmas on wide ranges (e.g. 16-bit images), where
+	// the lattice (whose memory grows with the number of pixels) is used instead
+	if (img.channels() == 1 && BilateralGrid(img, sigma_space, sigma_color).bytes() <= BilateralGrid::max_bytes)
+		return bilateralGrid(img, sigma_color, sigma_space);
+	else
+		return bilateralPermutohedral(img, sigma_color, sigma_space);
+}
+
+cv::Mat aia::guidedFilter(const cv::Mat & guide, const cv::Mat & src, int radius, double eps, int subsample)
+{
+	// precondition checks
+	if (guide.channels() != 1 && guide.channels() != 3)
+		throw aia::error(aia::strprintf("guidedFilter: guide must have 1 or 3 channels, found %d", guide.channels()));
+	if (guide.size() != src.size())
+		throw aia::error(aia::strprintf("guidedFilter: guide (%d x %d) and source (%d x %d) have different sizes", guide.cols, guide.rows, src.cols, src.rows));
+	for (const cv::Mat* img : {&guide, &src})
+		if (img->depth() != CV_8U && img->depth() != CV_16U && img->depth() != CV_32F)
+			throw aia::error("guidedFilter: only 8-bit, 16-bit and float images are supported");
+	if (radius < 1)
+		throw aia::error(aia::strprintf("guidedFilter: radius must be positive (found %d)", radius));
+	if (eps <= 0)
+		throw aia::error(aia::strprintf("guidedFilter: eps must be positive (found %g)", eps));
+	if (subsample < 1)
+		throw aia::error(aia::strprintf("guidedFilter: subsample must be positive (found %d)", subsample));
+
+	cv::Mat guide_f, src_f;
+	guide.convertTo(guide_f, CV_32F);
+	src.convertTo(src_f, CV_32F);
+	cv::Mat out_img(src.rows, src.cols, src.type());
+	cv::Mat mean_coeffs;
+
+	// all in one go at full resolution
+	if (subsample == 1)
+	{
+		if (src.depth() == CV_8U)
+			guidedFilterImpl<unsigned char>(guide_f, src_f, radius, float(eps), mean_coeffs, &out_img);
+		else if (src.depth() == CV_16U)
+			guidedFilterImpl<unsigned short>(guide_f, src_f, radius, float(eps), mean_coeffs, &out_img);
+		else
+			guidedFilterImpl<float>(guide_f, src_f, radius, float(eps), mean_coeffs, &out_img);
+		return out_img;
+	}
+
+	// fast guided filter: coefficients on the subsampled images, output on the full-resolution guide
+	cv::Size small_size(std::max(1, guide.cols / subsample), std::max(1, guide.rows / subsample));
+	cv::Mat guide_small, src_small;
+	cv::resize(guide_f, guide_small, small_size, 0, 0, cv::INTER_AREA);
+	cv::resize(src_f, src_small, small_size, 0, 0, cv::INTER_AREA);
+	guidedFilterImpl<float>(guide_small, src_small, std::max(1, cvRound(double(radius) / subsample)), float(eps), mean_coeffs, 0);
+	cv::resize(mean_coeffs, mean_coeffs, guide.size(), 0, 0, cv::INTER_LINEAR);
+
+	int n2 = mean_coeffs.channels();
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), src.rows));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int y = bands.start * src.rows / n_bands; y < bands.end * src.rows / n_bands; y++)
+		{
+			const float* I = guide_f.ptr<float>(y);
+			const float* coeffs = mean_coeffs.ptr<float>(y);
+			if (src.depth() == CV_8U)
+				guidedCombineRow(I, guide.channels(), coeffs, 1, n2, out_img.ptr<unsigned char>(y), src.channels(), src.cols);
+			else if (src.depth() == CV_16U)
+				guidedCombineRow(I, guide.channels(), coeffs, 1, n2, out_img.ptr<unsigned short>(y), src.channels(), src.cols);
+			else
+				guidedCombineRow(I, guide.channels(), coeffs, 1, n2, out_img.ptr<float>(y), src.channels(), src.cols);
+		}
+	});
+
+	return out_img;
+}
+
+cv::Mat aia::guidedFilter(const cv::Mat & img, int radius, double eps, int subsample)
+{
+	return guidedFilter(img, img, radius, eps, subsample);
+}
+
+LocalStatistics::LocalStatistics(const cv::Mat & img, const cv::Mat & mask)
+{
+	setImage(img, mask);
+}
+
+void LocalStatistics::setImage(const cv::Mat & img, const cv::Mat & mask)
+{
+	// precondition checks
+	if (img.channels() != 1)
+		throw aia::error(aia::strprintf("LocalStatistics: single-channel image expected, found %d channels", img.channels()));
+	if (img.depth() != CV_8U && img.depth() != CV_16U && img.depth() != CV_32F && img.depth() != CV_64F)
+		throw aia::error("LocalStatistics: only 8-bit, 16-bit, float and double images are supported");
+	if (!mask.empty() && (mask.type() != CV_8U || mask.size() != img.size()))
+		throw aia::error("LocalStatistics: mask must be an 8-bit image of the same size of the image");
+
+	rows = img.rows;
+	cols = img.cols;
+	if (img.depth() == CV_8U || img.depth() == CV_16U)
+	{
+		if (img.depth() == CV_8U)
+			summedAreaTables<unsigned char>(img, mask, int_sum, int_sq_sum, count);
+		else
+			summedAreaTables<unsigned short>(img, mask, int_sum, int_sq_sum, count);
+		sum.clear();
+		sq_sum.clear();
+	}
+	else
+	{
+		if (img.depth() == CV_32F)
+			summedAreaTables<float>(img, mask, sum, sq_sum, count);
+		else
+			summedAreaTables<double>(img, mask, sum, sq_sum, count);
+		int_sum.clear();
+		int_sq_sum.clear();
+	}
+}
+
+void LocalStatistics::at(int x, int y, int ksize, double & mean, double & variance) const
+{
+	int wy0 = std::max(0, y - ksize / 2), wy1 = std::min(rows, y - ksize / 2 + ksize);
+	int wx0 = std::max(0, x - ksize / 2), wx1 = std::min(cols, x - ksize / 2 + ksize);
+	double s, sq;
+	int n;
+	if (!int_sum.empty())
+	{
+		long long is, isq;
+		summedAreaWindow(int_sum, int_sq_sum, count, cols, wx0, wy0, wx1, wy1, is, isq, n);
+		s = double(is);
+		sq = double(isq);
+	}
+	else
+		summedAreaWindow(sum, sq_sum, count, cols, wx0, wy0, wx1, wy1, s, sq, n);
+	mean = n ? s / n : 0;
+	variance = n ? std::max(0.0, (sq - s * mean) / n) : 0;
+}
+
+cv::Mat LocalStatistics::compute(int ksize, int stat) const
+{
+	// precondition checks
+	if (rows == 0)
+		throw aia::error("LocalStatistics: no image set");
+	if (ksize < 1)
+		throw aia::error(aia::strprintf("LocalStatistics: window size must be positive (found %d)", ksize));
+
+	cv::Mat out(rows, cols, stat < 0 ? CV_32FC3 : CV_32F);
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), rows));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int band = bands.start; band < bands.end; band++)
+		{
+			int y0 = band * rows / n_bands, y1 = (band + 1) * rows / n_bands;
+			if (!int_sum.empty())
+				summedAreaStatistics(int_sum, int_sq_sum, count, rows, cols, ksize, stat, out, y0, y1);
+			else
+				summedAreaStatistics(sum, sq_sum, count, rows, cols, ksize, stat, out, y0, y1);
+		}
+	});
+	return out;
+}
+
+cv::Mat LocalStatistics::statistics(int ksize) const
+{
+	return compute(ksize, -1);
+}
+
+cv::Mat LocalStatistics::mean(int ksize) const
+{
+	return compute(ksize, 0);
+}
+
+cv::Mat LocalStatistics::variance(int ksize) const
+{
+	return compute(ksize, 1);
+}
+
+cv::Mat LocalStatistics::stdev(int ksize) const
+{
+	return compute(ksize, 2);
+}
+
+void aia::sobelGradient(const cv::Mat & img, cv::Mat & mag, cv::Mat & angle, cv::Mat & edges, double threshold, double mag_scale, int angle_bins, double alpha0, double alpha1)
+{
+	// precondition checks
+	if (img.type() != CV_8U)
+		throw aia::error(aia::strprintf("sobelGradient: 8-bit single-channel image expected, found type %d", img.type()));
+	if (angle_bins < 0 || angle_bins > 256)
+		throw aia::error(aia::strprintf("sobelGradient: orientation bins must be in [0, 256] (found %d)", angle_bins));
+
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), img.rows));
+
+	// magnitude normalized by its maximum
+	if (mag_scale <= 0)
+	{
+		std::vector<float> band_max(n_bands, 0.0f);
+		cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+		{
+			for (int band = bands.start; band < bands.end; band++)
+				band_max[band] = sobelMaxMagnitudeBand(img, band * img.rows / n_bands, (band + 1) * img.rows / n_bands);
+		});
+		float max_mag = *std::max_element(band_max.begin(), band_max.end());
+		mag_scale = max_mag > 0 ? 255.0 / max_mag : 1.0;
+	}
+
+	SobelGradientParams p;
+	p.scale = float(mag_scale);
+	p.threshold = float(threshold);
+	p.angle_bins = angle_bins;
+	p.alpha0 = float(alpha0);
+	p.alpha1 = float(alpha1);
+	p.angle_filter = !(alpha0 <= 0 && alpha1 >= 360);
+
+	mag.create(img.rows, img.cols, CV_8U);
+	if (angle_bins > 0)
+		angle.create(img.rows, img.cols, CV_8U);
+	else
+		angle.release();
+	if (threshold >= 0)
+		edges.create(img.rows, img.cols, CV_8U);
+	else
+		edges.release();
+
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int band = bands.start; band < bands.end; band++)
+			sobelGradientBand(img, p, mag, angle, edges, band * img.rows / n_bands, (band + 1) * img.rows / n_bands);
+	});
+}
+
+cv::Mat aia::sobelEdges(const cv::Mat & img, double threshold, double mag_scale, double alpha0, double alpha1)
+{
+	cv::Mat mag, angle, edges;
+	sobelGradient(img, mag, angle, edges, std::max(0.0, threshold), mag_scale, 0, alpha0, alpha1);
+	return edges;
+}
+
+cv::Mat aia::zeroCrossings(const cv::Mat & response, double threshold)
+{
+	// precondition checks
+	if (response.type() != CV_32F)
+		throw aia::error(aia::strprintf("zeroCrossings: float single-channel response expected, found type %d", response.type()));
+
+	cv::Mat out_img(response.rows, response.cols, CV_8U, cv::Scalar(0));
+	if (response.rows < 3 || response.cols < 3)
+		return out_img;
+
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), response.rows - 2));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int band = bands.start; band < bands.end; band++)
+			zeroCrossingsBand(response, float(threshold), out_img,
+				1 + band * (response.rows - 2) / n_bands, 1 + (band + 1) * (response.rows - 2) / n_bands);
+	});
+	return out_img;
+}
+
+cv::Mat aia::canny(const cv::Mat & img, double low, double high, double sigma, bool L2gradient)
+{
+	// precondition checks
+	if (img.type() != CV_8U)
+		throw aia::error(aia::strprintf("canny: 8-bit single-channel image expected, found type %d", img.type()));
+
+	// same threshold conventions as cv::Canny
+	if (low > high)
+		std::swap(low, high);
+	if (L2gradient)
+	{
+		low = std::min(32767.0, low);
+		high = std::min(32767.0, high);
+		if (low > 0)
+			low *= low;
+		if (high > 0)
+			high *= high;
+	}
+
+	cv::Mat kernel;
+	if (sigma > 0)
+		kernel = cv::getGaussianKernel(cvRound(sigma * 6 + 1) | 1, sigma, CV_32F);
+
+	// smoothing, gradient and non-maximum suppression, then components of the candidates within each band
+	int rows = img.rows, cols = img.cols;
+	cv::Mat map(rows, cols, CV_8U);
+	std::vector<int> parent(size_t(rows) * cols);
+	std::vector<unsigned char> strong(size_t(rows) * cols, 0);
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), rows / 8));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int band = bands.start; band < bands.end; band++)
+		{
+			int y0 = band * rows / n_bands, y1 = (band + 1) * rows / n_bands;
+			cannyCandidatesBand(img, kernel, cvFloor(low), cvFloor(high), L2gradient, map, y0, y1);
+			cannyComponentsBand(map, parent, strong, y0, y1);
+		}
+	});
+
+	// merge the components that touch across band borders
+	for (int band = 1; band < n_bands; band++)
+	{
+		int y = band * rows / n_bands;
+		const unsigned char* map_yRow = map.ptr<unsigned char>(y);
+		const unsigned char* map_prevRow = map.ptr<unsigned char>(y - 1);
+		for (int x = 0; x < cols; x++)
+			if (map_yRow[x])
+				for (int dx = -1; dx <= 1; dx++)
+					if (x + dx >= 0 && x + dx < cols && map_prevRow[x + dx])
+						uniteRoots(parent, strong, y * cols + x, (y - 1) * cols + x + dx);
+	}
+
+	// hysteresis: candidates whose component contains a strong candidate
+	cv::Mat edges(rows, cols, CV_8U);
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int y = bands.start * rows / n_bands; y < bands.end * rows / n_bands; y++)
+		{
+			const unsigned char* map_yRow = map.ptr<unsigned char>(y);
+			unsigned char* edges_yRow = edges.ptr<unsigned char>(y);
+			for (int x = 0; x < cols; x++)
+				edges_yRow[x] = map_yRow[x] && strong[findRootShared(parent, y * cols + x)] ? 255 : 0;
+		}
+	});
+
+	return edges;
+}
+
+GaborBank::GaborBank(cv::Size _ksize, double _sigma, int _n_orientations, double _lambd, double _gamma)
+	: ksize(_ksize), sigma(_sigma), lambd(_lambd), gamma(_gamma), n_orientations(_n_orientations)
+{
+	// precondition checks
+	if (n_orientations < 1 || n_orientations > 256)
+		throw aia::error(aia::strprintf("GaborBank: the number of orientations must be in [1, 256], found %d", n_orientations));
+	if (ksize.width < 1 || ksize.height < 1)
+		throw aia::error("GaborBank: empty kernel size");
+}
+
+cv::Mat GaborBank::kernel(int k, bool imaginary) const
+{
+	return cv::getGaborKernel(ksize, sigma, theta(k), lambd, gamma, imaginary ? CV_PI * 0.5 : 0);
+}
+
+void GaborBank::prepare(cv::Size _img_size)
+{
+	if (_img_size == img_size)
+		return;
+	img_size = _img_size;
+
+	// linear (not circular) correlation on the image padded by the kernel size
+	dft_size = cv::Size(cv::getOptimalDFTSize(img_size.width + ksize.width - 1),
+		cv::getOptimalDFTSize(img_size.height + ksize.height - 1));
+
+	// complex kernel with tap (u, v) at (-u, -v) modulo the transform size, so that the correlation
+	// at pixel (x, y) ends up at (x, y) of the inverse transform
+	spectra.resize(n_orientations);
+	cv::parallel_for_(cv::Range(0, n_orientations), [&](const cv::Range & range)
+	{
+		for (int k = range.start; k < range.end; k++)
+		{
+			cv::Mat re = kernel(k, false), im = kernel(k, true);
+			cv::Mat K(dft_size, CV_32FC2, cv::Scalar(0, 0));
+			for (int v = 0; v < ksize.height; v++)
+			{
+				float* K_row = K.ptr<float>((dft_size.height - v) % dft_size.height);
+				for (int u = 0; u < ksize.width; u++)
+				{
+					int x = (dft_size.width - u) % dft_size.width;
+					K_row[2 * x] = float(re.ptr<double>(v)[u]);
+					K_row[2 * x + 1] = float(im.ptr<double>(v)[u]);
+				}
+			}
+			cv::dft(K, spectra[k]);
+		}
+	});
+}
+
+void GaborBank::filter(const cv::Mat & img, cv::Mat & magnitude, cv::Mat & orientation)
+{
+	// precondition checks
+	if (img.empty())
+		throw aia::error("GaborBank::filter: empty image");
+
+	prepare(img.size());
+	int rows = img.rows, cols = img.cols, cn = img.channels();
+	int ax = ksize.width / 2, ay = ksize.height / 2;
+
+	// one forward transform per channel of the padded image (as cv::filter2D, BORDER_REFLECT_101)
+	cv::Mat img_float;
+	img.convertTo(img_float, CV_MAKETYPE(CV_32F, cn));
+	std::vector<cv::Mat> channels, channel_spectra(cn);
+	cv::split(img_float, channels);
+	int padded_rows = rows + ksize.height - 1;
+	cv::parallel_for_(cv::Range(0, cn), [&](const cv::Range & range)
+	{
+		for (int c = range.start; c < range.end; c++)
+		{
+			cv::Mat padded(dft_size, CV_32F, cv::Scalar(0));
+			cv::Mat padded_roi = padded(cv::Rect(0, 0, cols + ksize.width - 1, padded_rows));
+			cv::copyMakeBorder(channels[c], padded_roi, ay, ksize.height - 1 - ay, ax, ksize.width - 1 - ax, cv::BORDER_REFLECT_101);
+			cv::dft(padded, channel_spectra[c], cv::DFT_COMPLEX_OUTPUT, padded_rows);
+		}
+	});
+
+	// products with the kernel spectra and inverse transforms in parallel over bands of orientations,
+	// each one keeping its own running maximum (only the first 'rows' rows of the inverse are needed)
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), n_orientations));
+	std::vector<cv::Mat> band_mag(n_bands), band_arg(n_bands);
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int band = bands.start; band < bands.end; band++)
+		{
+			band_mag[band] = cv::Mat(rows, cols, CV_MAKETYPE(CV_32F, cn), cv::Scalar::all(-1));
+			band_arg[band] = cv::Mat(rows, cols, CV_MAKETYPE(CV_8U, cn), cv::Scalar::all(0));
+			cv::Mat product, response;
+			for (int k = band * n_orientations / n_bands; k < (band + 1) * n_orientations / n_bands; k++)
+				for (int c = 0; c < cn; c++)
+				{
+					cv::mulSpectrums(channel_spectra[c], spectra[k], product, 0);
+					cv::dft(product, response, cv::DFT_INVERSE | cv::DFT_SCALE, rows);
+					for (int y = 0; y < rows; y++)
+						gaborReduceRow(response.ptr<float>(y), cols, k,
+							band_mag[band].ptr<float>(y) + c, band_arg[band].ptr<unsigned char>(y) + c, cn);
+				}
+		}
+	});
+
+	// merge the bands in orientation order (ties keep the first orientation, as a serial loop)
+	magnitude = band_mag[0];
+	orientation = band_arg[0];
+	for (int band = 1; band < n_bands; band++)
+		for (int y = 0; y < rows; y++)
+		{
+			float* mag_yRow = magnitude.ptr<float>(y);
+			unsigned char* arg_yRow = orientation.ptr<unsigned char>(y);
+			const float* band_mag_yRow = band_mag[band].ptr<float>(y);
+			const unsigned char* band_arg_yRow = band_arg[band].ptr<unsigned char>(y);
+			for (int x = 0; x < cols * cn; x++)
+				if (band_mag_yRow[x] > mag_yRow[x])
+				{
+					mag_yRow[x] = band_mag_yRow[x];
+					arg_yRow[x] = band_arg_yRow[x];
+				}
+		}
+}
+
+cv::Mat aia::erodeRect(const cv::Mat & img, cv::Size ksize)
+{
+	return morphologyRect(img, cv::MORPH_ERODE, ksize);
+}
+
+cv::Mat aia::dilateRect(const cv::Mat & img, cv::Size ksize)
+{
+	return morphologyRect(img, cv::MORPH_DILATE, ksize);
+}
+
+cv::Mat aia::morphologyRect(const cv::Mat & img, int op, cv::Size ksize)
+{
+	// precondition checks
+	if (img.depth() != CV_8U && img.depth() != CV_16U && img.depth() != CV_32F)
+		throw aia::error("morphologyRect: only 8-bit, 16-bit and float images are supported");
+	if (ksize.width < 1 || ksize.height < 1)
+		throw aia::error(aia::strprintf("morphologyRect: invalid structuring element size %d x %d", ksize.width, ksize.height));
+
+	return morphologyCompose(img, op, [&](const cv::Mat & src, bool dilate)
+	{
+		return dilate ? morphRect<true>(src, ksize) : morphRect<false>(src, ksize);
+	}, "morphologyRect");
+}
+
+cv::Mat aia::morphologyEllipse(const cv::Mat & img, int op, cv::Size ksize, int exact_size)
+{
+	// precondition checks
+	if (img.depth() != CV_8U && img.depth() != CV_16U && img.depth() != CV_32F)
+		throw aia::error("morphologyEllipse: only 8-bit, 16-bit and float images are supported");
+	if (ksize.width < 1 || ksize.height < 1)
+		throw aia::error(aia::strprintf("morphologyEllipse: invalid structuring element size %d x %d", ksize.width, ksize.height));
+
+	// small elements: exact ellipse, the generic per-offset loop of OpenCV is cheap enough
+	if (std::max(ksize.width, ksize.height) < exact_size)
+	{
+		cv::Mat out_img;
+		cv::morphologyEx(img, out_img, op, cv::getStructuringElement(cv::MORPH_ELLIPSE, ksize));
+		return out_img;
+	}
+
+	std::vector<PeriodicLine> lines = ellipseLines(ksize);
+	return morphologyCompose(img, op, [&](const cv::Mat & src, bool dilate)
+	{
+		return dilate ? morphEllipse<true>(src, lines) : morphEllipse<false>(src, lines);
+	}, "morphologyEllipse");
+}
+
+cv::Mat aia::reconstructBinary(const cv::Mat & marker, const cv::Mat & mask, int connectivity)
+{
+	// precondition checks
+	if (marker.type() != CV_8U || mask.type() != CV_8U)
+		throw aia::error("reconstructBinary: 8-bit single-channel marker and mask expected");
+	if (marker.size() != mask.size())
+		throw aia::error("reconstructBinary: marker and mask must have the same size");
+	if (connectivity != 4 && connectivity != 8)
+		throw aia::error(aia::strprintf("reconstructBinary: connectivity must be 4 or 8, found %d", connectivity));
+
+	// state of each pixel with a 1-pixel frame, so that neighbors need no bounds checks:
+	// 0 = outside the mask (or the image), 1 = mask, 2 = reconstructed
+	int rows = mask.rows, cols = mask.cols;
+	int stride = cols + 2;
+	std::vector<unsigned char> state(size_t(rows + 2) * stride, 0);
+	for (int y = 0; y < rows; y++)
+	{
+		const unsigned char* marker_yRow = marker.ptr<unsigned char>(y);
+		const unsigned char* mask_yRow = mask.ptr<unsigned char>(y);
+		unsigned char* state_yRow = &state[size_t(y + 1) * stride + 1];
+		for (int x = 0; x < cols; x++)
+			state_yRow[x] = mask_yRow[x] ? (marker_yRow[x] ? 2 : 1) : 0;
+	}
+	const int offsets[] = { -1, 1, -stride, stride, -stride - 1, -stride + 1, stride - 1, stride + 1 };
+
+	// FIFO initialized with the reconstructed pixels that have a neighbor in the mask not yet reconstructed
+	// (the contour of the marker), then propagation within the mask: each pixel enters the queue at most once
+	std::vector<int> fifo;
+	for (int y = 1; y <= rows; y++)
+		for (int p = y * stride + 1; p <= y * stride + cols; p++)
+			if (state[p] == 2)
+				for (int k = 0; k < connectivity; k++)
+					if (state[p + offsets[k]] == 1)
+					{
+						fifo.push_back(p);
+						break;
+					}
+	for (size_t head = 0; head < fifo.size(); head++)
+		for (int k = 0; k < connectivity; k++)
+		{
+			int q = fifo[head] + offsets[k];
+			if (state[q] == 1)
+			{
+				state[q] = 2;
+				fifo.push_back(q);
+			}
+		}
+
+	cv::Mat out_img(rows, cols, CV_8U);
+	for (int y = 0; y < rows; y++)
+	{
+		const unsigned char* state_yRow = &state[size_t(y + 1) * stride + 1];
+		unsigned char* out_yRow = out_img.ptr<unsigned char>(y);
+		for (int x = 0; x < cols; x++)
+			out_yRow[x] = state_yRow[x] == 2 ? 255 : 0;
+	}
+	return out_img;
+}
+
+cv::Mat aia::fillHoles(const cv::Mat & img, int connectivity)
+{
+	// background reachable from the image border
+	cv::Mat background = img == 0;
+	cv::Mat outside = reconstructBinary(borderMarker(background), background, connectivity);
+	return 255 - outside;
+}
+
+cv::Mat aia::clearBorder(const cv::Mat & img, int connectivity)
+{
+	cv::Mat foreground = img != 0;
+	cv::Mat touching = reconstructBinary(borderMarker(foreground), foreground, connectivity);
+	return foreground - touching;
+}
+
+cv::Mat aia::openingByReconstruction(const cv::Mat & img, cv::Size ksize, int connectivity)
+{
+	cv::Mat foreground = img != 0;
+	return reconstructBinary(erodeRect(foreground, ksize), foreground, connectivity);
+}
+
+cv::Mat aia::reconstructGrayscale(const cv::Mat & marker, const cv::Mat & mask, int connectivity)
+{
+	// precondition checks
+	if (marker.type() != mask.type() || marker.size() != mask.size())
+		throw aia::error("reconstructGrayscale: marker and mask must have the same size and type");
+	if (mask.depth() != CV_8U && mask.depth() != CV_16U && mask.depth() != CV_32F)
+		throw aia::error("reconstructGrayscale: only 8-bit, 16-bit and float images are supported");
+	if (connectivity != 4 && connectivity != 8)
+		throw aia::error(aia::strprintf("reconstructGrayscale: connectivity must be 4 or 8, found %d", connectivity));
+
+	// channels are independent: one reconstruction per channel, in parallel
+	int cn = mask.channels();
+	std::vector<cv::Mat> marker_channels, mask_channels, out_channels(cn);
+	cv::split(marker, marker_channels);
+	cv::split(mask, mask_channels);
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), cn));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int c = bands.start * cn / n_bands; c < bands.end * cn / n_bands; c++)
+		{
+			out_channels[c].create(mask.rows, mask.cols, mask.depth());
+			if (mask.depth() == CV_8U)
+				reconstructGrayscaleChannel<unsigned char>(marker_channels[c], mask_channels[c], out_channels[c], connectivity);
+			else if (mask.depth() == CV_16U)
+				reconstructGrayscaleChannel<unsigned short>(marker_channels[c], mask_channels[c], out_channels[c], connectivity);
+			else
+				reconstructGrayscaleChannel<float>(marker_channels[c], mask_channels[c], out_channels[c], connectivity);
+		}
+	});
+
+	cv::Mat out_img;
+	cv::merge(out_channels, out_img);
+	return out_img;
+}
+
+BinaryImage::BinaryImage(int _rows, int _cols, bool value) :
+	rows(_rows), cols(_cols), words((_cols + 63) / 64), bits(size_t(_rows) * ((_cols + 63) / 64), value ? ~uint64_t(0) : 0)
+{
+	clearPadding();
+}
+
+BinaryImage::BinaryImage(const cv::Mat & img) : BinaryImage(img.rows, img.cols)
+{
+	// precondition checks
+	if (img.channels() != 1)
+		throw aia::error("BinaryImage: only single-channel images are supported");
+
+	cv::Mat img8 = img;
+	if (img.depth() != CV_8U)
+		img8 = img != 0;
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), rows));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int y = bands.start * rows / n_bands; y < bands.end * rows / n_bands; y++)
+			packRow(img8.ptr<unsigned char>(y), cols, &bits[size_t(y) * words]);
+	});
+}
+
+cv::Mat BinaryImage::toMat() const
+{
+	cv::Mat img(rows, cols, CV_8U);
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), rows));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int y = bands.start * rows / n_bands; y < bands.end * rows / n_bands; y++)
+			unpackRow(&bits[size_t(y) * words], cols, img.ptr<unsigned char>(y));
+	});
+	return img;
+}
+
+void BinaryImage::set(int x, int y, bool value)
+{
+	uint64_t & word = bits[size_t(y) * words + x / 64];
+	uint64_t bit = uint64_t(1) << (x % 64);
+	word = value ? word | bit : word & ~bit;
+}
+
+void BinaryImage::clearPadding()
+{
+	if (words == 0 || cols % 64 == 0)
+		return;
+	uint64_t mask = lastWordMask(cols);
+	for (int y = 0; y < rows; y++)
+		bits[size_t(y) * words + words - 1] &= mask;
+}
+
+void BinaryImage::checkSize(const BinaryImage & other, const char* op) const
+{
+	if (rows != other.rows || cols != other.cols)
+		throw aia::error(aia::strprintf("BinaryImage::%s: images must have the same size, found %d x %d and %d x %d",
+			op, cols, rows, other.cols, other.rows));
+}
+
+BinaryImage BinaryImage::operator~() const
+{
+	BinaryImage out = *this;
+	for (size_t i = 0; i < out.bits.size(); i++)
+		out.bits[i] = ~out.bits[i];
+	out.clearPadding();
+	return out;
+}
+
+BinaryImage & BinaryImage::operator&=(const BinaryImage & other)
+{
+	checkSize(other, "operator&");
+	for (size_t i = 0; i < bits.size(); i++)
+		bits[i] &= other.bits[i];
+	return *this;
+}
+
+BinaryImage & BinaryImage::operator|=(const BinaryImage & other)
+{
+	checkSize(other, "operator|");
+	for (size_t i = 0; i < bits.size(); i++)
+		bits[i] |= other.bits[i];
+	return *this;
+}
+
+BinaryImage & BinaryImage::operator^=(const BinaryImage & other)
+{
+	checkSize(other, "operator^");
+	for (size_t i = 0; i < bits.size(); i++)
+		bits[i] ^= other.bits[i];
+	return *this;
+}
+
+BinaryImage & BinaryImage::operator-=(const BinaryImage & other)
+{
+	checkSize(other, "operator-");
+	for (size_t i = 0; i < bits.size(); i++)
+		bits[i] &= ~other.bits[i];
+	return *this;
+}
+
+BinaryImage BinaryImage::operator&(const BinaryImage & other) const
+{
+	BinaryImage out = *this;
+	return out &= other;
+}
+
+BinaryImage BinaryImage::operator|(const BinaryImage & other) const
+{
+	BinaryImage out = *this;
+	return out |= other;
+}
+
+BinaryImage BinaryImage::operator^(const BinaryImage & other) const
+{
+	BinaryImage out = *this;
+	return out ^= other;
+}
+
+BinaryImage BinaryImage::operator-(const BinaryImage & other) const
+{
+	BinaryImage out = *this;
+	return out -= other;
+}
+
+bool BinaryImage::operator==(const BinaryImage & other) const
+{
+	return rows == other.rows && cols == other.cols && bits == other.bits;
+}
+
+long long BinaryImage::count() const
+{
+	long long n = 0;
+	for (size_t i = 0; i < bits.size(); i++)
+		n += std::bitset<64>(bits[i]).count();
+	return n;
+}
+
+long long BinaryImage::countDifferent(const BinaryImage & other) const
+{
+	checkSize(other, "countDifferent");
+	long long n = 0;
+	for (size_t i = 0; i < bits.size(); i++)
+		n += std::bitset<64>(bits[i] ^ other.bits[i]).count();
+	return n;
+}
+
+BinaryImage BinaryImage::shift(int dx, int dy, bool fill) const
+{
+	BinaryImage out(rows, cols, fill);
+	if (empty())
+		return out;
+
+	// source rows get their padding bits set to 'fill', so that they are shifted in as uncovered pixels
+	uint64_t fill_word = fill ? ~uint64_t(0) : 0;
+	uint64_t mask = lastWordMask(cols);
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), rows));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		std::vector<uint64_t> row(words);
+		for (int y = bands.start * rows / n_bands; y < bands.end * rows / n_bands; y++)
+		{
+			int sy = y - dy;
+			if (sy < 0 || sy >= rows)
+				continue;
+			const uint64_t* src = &bits[size_t(sy) * words];
+			uint64_t* dst = &out.bits[size_t(y) * words];
+			std::copy(src, src + words, row.begin());
+			row[words - 1] |= fill_word & ~mask;
+			for (int i = 0; i < words; i++)
+				dst[i] = shiftedWord(&row[0], words, i, -dx, fill_word);
+			dst[words - 1] &= mask;
+		}
+	});
+	return out;
+}
+
+BinaryImage BinaryImage::morph3x3(bool erode) const
+{
+	// erosion is the dilation of the complement, complemented: words are complemented when loaded and stored
+	BinaryImage out(rows, cols);
+	uint64_t mask = lastWordMask(cols);
+	uint64_t invert = erode ? ~uint64_t(0) : 0;
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), rows));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		// horizontal dilations of rows y - 1, y, y + 1 (0 outside the image)
+		std::vector<uint64_t> buffer(3 * words);
+		uint64_t* horiz[3] = { &buffer[0], &buffer[words], &buffer[2 * words] };
+		auto horizontal = [&](int y, uint64_t* dst)
+		{
+			if (y < 0 || y >= rows)
+			{
+				std::fill(dst, dst + words, uint64_t(0));
+				return;
+			}
+			const uint64_t* src = &bits[size_t(y) * words];
+			auto load = [&](int i) { return i < words ? (src[i] ^ invert) & (i == words - 1 ? mask : ~uint64_t(0)) : 0; };
+			uint64_t prev = 0, cur = load(0);
+			for (int i = 0; i < words; i++)
+			{
+				uint64_t next = load(i + 1);
+				dst[i] = cur | (cur << 1) | (prev >> 63) | (cur >> 1) | (next << 63);
+				prev = cur;
+				cur = next;
+			}
+		};
+
+		int y0 = bands.start * rows / n_bands, y1 = bands.end * rows / n_bands;
+		horizontal(y0 - 1, horiz[0]);
+		horizontal(y0, horiz[1]);
+		for (int y = y0; y < y1; y++)
+		{
+			horizontal(y + 1, horiz[2]);
+			uint64_t* dst = &out.bits[size_t(y) * words];
+			for (int i = 0; i < words; i++)
+				dst[i] = (horiz[0][i] | horiz[1][i] | horiz[2][i]) ^ invert;
+			dst[words - 1] &= mask;
+			std::rotate(horiz, horiz + 1, horiz + 3);
+		}
+	});
+	return out;
+}
+
+BinaryImage BinaryImage::morphRect(cv::Size ksize, bool erode) const
+{
+	// precondition checks
+	if (ksize.width < 1 || ksize.height < 1)
+		throw aia::error(aia::strprintf("BinaryImage: invalid element size %d x %d", ksize.width, ksize.height));
+
+	if (empty())
+		return *this;
+	if (ksize.width == 3 && ksize.height == 3)
+		return morph3x3(erode);
+
+	// erosion is the dilation of the complement, complemented: rows are complemented before the
+	// horizontal pass and after the vertical one
+	uint64_t mask = lastWordMask(cols);
+	uint64_t invert = erode ? ~uint64_t(0) : 0;
+	int ax = ksize.width / 2, ay = ksize.height / 2;
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), rows));
+
+	// horizontal pass: pixels [x - ax, x - ax + width) = run of width - ax pixels starting at x
+	// OR run of ax + 1 pixels ending at x
+	std::vector<uint64_t> horiz(bits.size(), 0);
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		std::vector<uint64_t> row(words), run(words);
+		for (int y = bands.start * rows / n_bands; y < bands.end * rows / n_bands; y++)
+		{
+			const uint64_t* src = &bits[size_t(y) * words];
+			for (int i = 0; i < words; i++)
+				row[i] = src[i] ^ invert;
+			row[words - 1] &= mask;
+			uint64_t* dst = &horiz[size_t(y) * words];
+			accumulateRuns(&row[0], words, ksize.width - ax, true, &run[0], dst);
+			accumulateRuns(&row[0], words, ax + 1, false, &run[0], dst);
+		}
+	});
+
+	// vertical pass (van Herk/Gil-Werman on whole rows): rows [y - ay, y - ay + height) are the extended
+	// rows [y, y + height) with extended row e = image row e - ay (0 outside the image), split into blocks
+	// of 'height' rows with prefix and suffix ORs, so that each window is suffix(y) | prefix(y + height - 1)
+	int h = ksize.height;
+	int ext_rows = rows + h - 1;
+	int n_blocks = (ext_rows + h - 1) / h;
+	std::vector<uint64_t> prefix(size_t(ext_rows) * words), suffix(size_t(ext_rows) * words);
+	auto extRow = [&](int e) { return e - ay >= 0 && e - ay < rows ? &horiz[size_t(e - ay) * words] : 0; };
+	int n_block_bands = std::max(1, std::min(cv::getNumThreads(), n_blocks));
+	cv::parallel_for_(cv::Range(0, n_block_bands), [&](const cv::Range & bands)
+	{
+		for (int b = bands.start * n_blocks / n_block_bands; b < bands.end * n_blocks / n_block_bands; b++)
+		{
+			int e0 = b * h, e1 = std::min(ext_rows, e0 + h);
+			for (int e = e0; e < e1; e++)
+			{
+				const uint64_t* src = extRow(e);
+				uint64_t* dst = &prefix[size_t(e) * words];
+				for (int i = 0; i < words; i++)
+					dst[i] = (src ? src[i] : 0) | (e > e0 ? dst[i - words] : 0);
+			}
+			for (int e = e1 - 1; e >= e0; e--)
+			{
+				const uint64_t* src = extRow(e);
+				uint64_t* dst = &suffix[size_t(e) * words];
+				for (int i = 0; i < words; i++)
+					dst[i] = (src ? src[i] : 0) | (e < e1 - 1 ? dst[i + words] : 0);
+			}
+		}
+	});
+
+	BinaryImage out(rows, cols);
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		for (int y = bands.start * rows / n_bands; y < bands.end * rows / n_bands; y++)
+		{
+			const uint64_t* s = &suffix[size_t(y) * words];
+			const uint64_t* p = &prefix[size_t(y + h - 1) * words];
+			uint64_t* dst = &out.bits[size_t(y) * words];
+			for (int i = 0; i < words; i++)
+				dst[i] = (s[i] | p[i]) ^ invert;
+			dst[words - 1] &= mask;
+		}
+	});
+	return out;
+}
+
+BinaryImage BinaryImage::erode(cv::Size ksize) const
+{
+	return morphRect(ksize, true);
+}
+
+BinaryImage BinaryImage::dilate(cv::Size ksize) const
+{
+	return morphRect(ksize, false);
+}
+
+BinaryImage BinaryImage::hitOrMiss(const cv::Mat & kernel) const
+{
+	// precondition checks
+	if (kernel.empty() || kernel.channels() != 1)
+		throw aia::error("BinaryImage::hitOrMiss: the kernel must be a non-empty single-channel matrix");
+	if (kernel.depth() != CV_8S && kernel.depth() != CV_32S)
+		throw aia::error("BinaryImage::hitOrMiss: the kernel must contain 8-bit or 32-bit signed integers");
+
+	cv::Mat k;
+	kernel.convertTo(k, CV_32S);
+	BinaryImage out(rows, cols, true);
+	if (empty())
+		return out;
+
+	// each output row is the AND of the kernel rows' source rows (foreground) and of their complements
+	// (background), shifted by the kernel columns; pixels outside the image match both, so rows outside
+	// the image are skipped and the padding bits of the source rows are set to 1
+	uint64_t mask = lastWordMask(cols);
+	int ax = k.cols / 2, ay = k.rows / 2;
+	int n_bands = std::max(1, std::min(cv::getNumThreads(), rows));
+	cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range & bands)
+	{
+		std::vector<uint64_t> foreground(words), background(words);
+		for (int y = bands.start * rows / n_bands; y < bands.end * rows / n_bands; y++)
+		{
+			uint64_t* dst = &out.bits[size_t(y) * words];
+			for (int v = 0; v < k.rows; v++)
+			{
+				int sy = y + v - ay;
+				if (sy < 0 || sy >= rows)
+					continue;
+				const uint64_t* src = &bits[size_t(sy) * words];
+				for (int i = 0; i < words; i++)
+				{
+					foreground[i] = src[i];
+					background[i] = ~src[i];
+				}
+				foreground[words - 1] |= ~mask;
+
+				const int* kRow = k.ptr<int>(v);
+				for (int u = 0; u < k.cols; u++)
+				{
+					if (kRow[u] != 1 && kRow[u] != -1)
+						continue;
+					const uint64_t* row = kRow[u] == 1 ? &foreground[0] : &background[0];
+					for (int i = 0; i < words; i++)
+						dst[i] &= shiftedWord(row, words, i, u - ax, ~uint64_t(0));
+				}
+			}
+			dst[words - 1] &= mask;
+		}
+	});
+	return out;
+}
@@ -0,0 +1,595 @@
+#pragma once
+
+#include "aiaConfig.h"
+#include "ucasConfig.h"
+#include <opencv2/core/core.hpp>
+#include <functional>
+#include <cstdint>
+
+// open namespace "aia"
+namespace aia
+{
+	// MEDIAN FILTERING
+	// constant-time median filter for 8-bit images (Perreault & Hebert, 2007)
+	// - one histogram per image column is updated incrementally while the window slides down,
+	//   and the window histogram is obtained by adding / removing column histograms while it slides right
+	// - histograms are two-level (16 coarse x 16 fine bins) so that finding the median costs
+	//   at most 32 steps, and fine bins are only brought up to date when the median falls into them
+	// - borders are replicated, so the result is identical to cv::medianBlur for every (odd) k
+	// - row bands are processed in parallel
+	cv::Mat medianHistogram(const cv::Mat & img, int k);
+
+	// median filter for 16-bit images of any size k (cv::medianBlur is limited to k <= 5)
+	// - the window histogram is two-level (256 coarse x 65536 fine bins) and slides along a serpentine
+	//   path, so each step only adds / removes one window row or column (2k updates per pixel)
+	// - the median is tracked incrementally and moves through the coarse bins over empty gray level ranges
+	// - row bands are processed in parallel and read directly from 'img' (borders are replicated
+	//   on the fly), so no memory besides the output image and one histogram per band is needed
+	cv::Mat medianHistogram16(const cv::Mat & img, int k);
+
+	// median filter entry point (borders are replicated, as in cv::medianBlur)
+	// - 8-bit images with k = 3, 5, 7: sorting networks of vector min/max operations, with
+	//   the widest instruction set the build enables (AVX-512, AVX2 or SSE2/NEON, chosen at compile time)
+	// - 8-bit images with k > 7: constant-time histogram method (see medianHistogram)
+	// - 16-bit images with k > 5: sliding histogram method (see medianHistogram16)
+	// - other cases: cv::medianBlur
+	cv::Mat median(const cv::Mat & img, int k);
+
+	// impulse candidates detection for medianAdaptive
+	enum ImpulseDetection
+	{
+		IMPULSE_EXTREMES,	// pixels equal to 0 or 255 (salt-and-pepper noise)
+		IMPULSE_OUTLIERS	// 3x3 local minima / maxima that differ from the 3x3 median by more than a threshold
+	};
+
+	// statistics of the last call to medianAdaptive
+	struct AdaptiveMedianStats
+	{
+		int candidates;					// number of impulse candidates
+		std::vector<int> processed;		// processed[i] = number of candidates resolved with a (3+2i)x(3+2i) window
+		int unresolved;					// candidates with no clean pixel within the largest window
+	};
+
+	// adaptive (switching) median filter for 8-bit grayscale images
+	// - impulse candidates are detected first, all other pixels are left untouched
+	// - each candidate is replaced with the median of the clean (= not candidate) pixels of the smallest
+	//   window, from 3x3 up to k_max x k_max, that contains at least one of them (or with the median
+	//   of the whole k_max x k_max window if there are none)
+	// - apart from detection, the cost depends on the number of candidates, not on the image size
+	cv::Mat medianAdaptive(const cv::Mat & img, int k_max = 7, ImpulseDetection detection = IMPULSE_EXTREMES,
+		int outlier_threshold = 40, AdaptiveMedianStats* stats = 0);
+
+
+	// HISTOGRAMS
+	// drop-in replacements of ucas::histogram and ucas::histogram_mask for 8- and 16-bit images
+	// - L = number of bins (0 = 256 for 8-bit and 65536 for 16-bit images), gray levels >= L are not counted
+	// - row bands are counted in parallel on separate sub-histograms
+	// - each sub-histogram has several interleaved count banks, consecutive pixels being counted on
+	//   different banks: this way, runs of equal values (e.g. flat backgrounds) do not stall on
+	//   updating the same counter over and over
+	std::vector<int> histogram(const cv::Mat & img, int L = 0);
+	std::vector<int> histogram_mask(const cv::Mat & img, const cv::Mat & mask, int L = 0);
+
+	// HISTOGRAM EQUALIZATION
+	// contrast-limited adaptive histogram equalization (CLAHE) of 8- and 16-bit grayscale images
+	// - same tiling, clip limit and interpolation conventions as cv::CLAHE: 8-bit results match OpenCV's
+	// - L = number of gray levels (0 = 256 for 8-bit and 65536 for 16-bit images), e.g. 16384 for
+	//   raw 14-bit mammograms, so that the whole output range [0, L-1] is used
+	// - n_bins = number of bins of the tile histograms (0 = min(L, 4096)), L and n_bins must be powers of 2
+	// - tile histograms and LUTs are computed in parallel, and the bilinear interpolation between the
+	//   LUTs of the four closest tiles is vectorized and processed in parallel row bands
+	cv::Mat clahe(const cv::Mat & img, double clip = 40.0, cv::Size grid = cv::Size(8, 8), int L = 0, int n_bins = 0);
+
+	// luminance-only equalization of color images without colorspace round-trips
+	// - colorValue: V = max(B, G, R) of a 3-channel image (i.e. the V channel of HSV)
+	// - applyValueGain: rebuild the color image once V has been transformed into V' (e.g. with CLAHE) by
+	//   scaling B, G and R by the gain V' / V: hue and saturation are unchanged, so this is the same as
+	//   replacing V in HSV space and converting back to BGR, but done in a single pass
+	// both support 8- and 16-bit images and process row bands in parallel
+	cv::Mat colorValue(const cv::Mat & img);
+	cv::Mat applyValueGain(const cv::Mat & img, const cv::Mat & value, const cv::Mat & value_eq);
+
+	// global and contrast-limited adaptive (CLAHE) histogram equalization of the luminance of 8- and 16-bit
+	// images, caching intermediate results for interactive use: each piece is recomputed only when its
+	// inputs change
+	// - luminance plane (L of Lab for color images): when the image changes
+	// - global histogram, CDF and equalization LUT: when the image changes
+	// - tile histograms: when the image or the tile grid changes
+	// - tile LUTs: when the tile histograms or the clip limit change
+	// - histogram of the equalized luminance: with the result it describes
+	class HistogramEqualizer
+	{
+		private:
+
+			cv::Mat img;								// source image
+			int L;										// number of gray levels
+			std::vector<cv::Mat> planes;				// Lab planes (color images) or the image itself (grayscale)
+
+			cv::Mat global_lut;							// global equalization LUT (empty = to be computed)
+			cv::Mat global_lum;							// global equalization of the luminance plane
+			cv::Mat global_result;						// global equalization result (empty = to be computed)
+			std::vector<int> global_histo;				// histogram of the global equalization of the luminance
+
+			cv::Size tiles_grid;						// tile grid of the cached tile histograms
+			int n_bins;									// number of bins of the tile histograms
+			cv::Mat tile_histos;						// tile histograms, one per row (empty = to be computed)
+			double clip_limit;							// clip limit of the cached tile LUTs
+			cv::Mat tile_luts;							// tile LUTs, one per row (empty = to be computed)
+			cv::Mat adaptive_lum;						// adaptive equalization of the luminance plane
+			cv::Mat adaptive_result;					// adaptive equalization result (empty = to be computed)
+			std::vector<int> adaptive_histo;			// histogram of the adaptive equalization of the luminance
+			cv::Mat last_lum;							// luminance plane of the last result
+			bool last_adaptive;							// whether the last result is the adaptive one
+
+			// rebuild the output image from an equalized luminance plane
+			cv::Mat compose(const cv::Mat & lum) const;
+
+		public:
+
+			HistogramEqualizer() : L(0), n_bins(0), clip_limit(0), last_adaptive(false) {}
+
+			// set the image to equalize and invalidate all cached results
+			// (L = number of gray levels, 0 = 256 for 8-bit and 65536 for 16-bit images)
+			void setImage(const cv::Mat & _img, int _L = 0);
+
+			// global histogram equalization
+			cv::Mat equalize();
+
+			// CLAHE with 'grid' tiles and OpenCV's clip limit convention (0 = no clipping), see clahe
+			cv::Mat equalizeAdaptive(cv::Size grid, double clip = 40.0);
+
+			// luminance plane of the last result
+			const cv::Mat & luminance() const { return last_lum; }
+
+			// histogram of the luminance plane of the last result (as aia::histogram)
+			const std::vector<int> & luminanceHistogram() const { return last_adaptive ? adaptive_histo : global_histo; }
+	};
+
+	// POINT TRANSFORMS
+	// point transforms are evaluated once per gray level and stored in a lookup table (LUT),
+	// i.e. a 1 x 256 (8-bit input) or 1 x 65536 (16-bit input) matrix whose depth is the output depth
+	// - build a LUT by evaluating 'f' on every input gray level (results are rounded and saturated)
+	cv::Mat pointLUT(int in_depth, int out_depth, const std::function<double(double)> & f);
+	// - gamma correction s = c * r^gamma, with c = (L-1)^(1-gamma)
+	cv::Mat gammaLUT(int depth, double gamma, int L = 0);
+	// - logarithmic transform s = c * log(1 + r), with c = (L-1) / log(L)
+	cv::Mat logLUT(int depth, int L = 0);
+	// - piecewise linear stretching through 'points' = (r, s) pairs sorted by r,
+	//   gray levels outside [first r, last r] are clamped to the first / last s
+	cv::Mat piecewiseLinearLUT(int depth, const std::vector<cv::Point2f> & points);
+	// apply 'lut' to each pixel (and channel) of 'src': 8- and 16-bit images are supported,
+	// row bands are processed in parallel and 'src' and 'dst' can be the same image
+	void applyLUT(const cv::Mat & src, const cv::Mat & lut, cv::Mat & dst);
+	// same as above, also calculating the histogram of 'dst' in the same pass
+	void applyLUT(const cv::Mat & src, const cv::Mat & lut, cv::Mat & dst, std::vector<int> & histo);
+
+	// chain of point operations folded into a single LUT, so that it is applied with one pass, e.g.
+	//     aia::PointPipeline(CV_16U, 16384).log().invert().stretch(1000, 15000).gamma(0.8).apply(img, img);
+	// each step is rounded and saturated exactly as if the operations were applied one after the other
+	class PointPipeline
+	{
+		private:
+
+			int depth;		// image depth (CV_8U or CV_16U)
+			int L;			// number of gray levels
+			cv::Mat lut;	// LUT of the whole chain
+
+		public:
+
+			// empty chain (= identity), L = 0 means 256 for 8-bit and 65536 for 16-bit images
+			PointPipeline(int _depth, int _L = 0);
+
+			// add a point operation to the chain
+			PointPipeline & then(const std::function<double(double)> & f);
+			PointPipeline & then(const cv::Mat & step_lut);
+			PointPipeline & log();									// s = c * log(1 + r), c = (L-1) / log(L)
+			PointPipeline & gamma(double gamma);					// s = c * r^gamma, c = (L-1)^(1-gamma)
+			PointPipeline & invert();								// s = L - 1 - r
+			PointPipeline & stretch(double r_min, double r_max);	// [r_min, r_max] --> [0, L-1]
+			PointPipeline & piecewiseLinear(const std::vector<cv::Point2f> & points);
+
+			// LUT of the whole chain
+			const cv::Mat & getLUT() const { return lut; }
+
+			// apply the whole chain with a single pass, optionally with the histogram of the result
+			void apply(const cv::Mat & src, cv::Mat & dst) const;
+			void apply(const cv::Mat & src, cv::Mat & dst, std::vector<int> & histo) const;
+	};
+
+	// histogram plot from bin counts, e.g. from applyLUT or PointPipeline::apply
+	// (bins are grouped so that the plot has at most 256 bars)
+	cv::Mat imhist(const std::vector<int> & histo, int height = 256);
+
+
+	// GAUSSIAN SMOOTHING
+	// recursive (IIR) Gaussian filter (Young & van Vliet, 1995) with Triggs & Sdika (2006) boundary conditions
+	// - third-order causal + anticausal recursions along rows and then along columns, so the cost
+	//   per pixel does not depend on sigma (sigma must be >= 0.5, sigma_y = 0 means sigma_y = sigma_x)
+	// - borders are replicated (as with cv::BORDER_REPLICATE)
+	// - 8-bit, 16-bit and float images with any number of channels are supported: rows are filtered
+	//   in parallel bands and columns in parallel strips, which are swept row by row for sequential
+	//   memory access; recursions run in double precision, since for large sigmas the poles are very
+	//   close to 1 and float rounding errors would be amplified
+	cv::Mat gaussianRecursive(const cv::Mat & img, double sigma_x, double sigma_y = 0);
+
+	// Gaussian smoothing entry point: cv::GaussianBlur for sigmas below 'sigma_iir', where the kernel
+	// is short and exact, and gaussianRecursive otherwise (borders are replicated in both cases)
+	cv::Mat gaussianBlur(const cv::Mat & img, double sigma_x, double sigma_y = 0, double sigma_iir = 3.0);
+
+	// unsharp masking out = img + amount * (img - gaussian(img, sigma)) in a single fused pass
+	// - detail is signed and computed in float, so negative detail is not lost to saturation
+	//   (as with 8-bit cv::Mat expressions), and only the result is saturated
+	// - detail whose absolute value is below 'threshold' is ignored (e.g. to avoid amplifying noise)
+	// - 'amounts' gives one amount per channel
+	// - borders are handled as in cv::GaussianBlur (BORDER_REFLECT_101)
+	// - row bands are processed in parallel, each keeping a ring of horizontally smoothed rows
+	//   as tall as the kernel: nothing else is allocated besides the output image
+	// 8-bit, 16-bit and float images with up to 4 channels are supported
+	cv::Mat unsharpMask(const cv::Mat & img, double sigma, double amount, double threshold = 0);
+	cv::Mat unsharpMask(const cv::Mat & img, double sigma, const cv::Scalar & amounts, double threshold = 0);
+
+	// Gaussian scale space of an image for interactive use (e.g. a trackbar that selects sigma next to
+	// others that select thresholds): blurred images are cached, so they are computed only once
+	// - levels of a sub-octave grid (sigma = 2^(k / levels_per_octave)) are built lazily, each from
+	//   the closest cached image with a smaller sigma, with the incremental blur sqrt(sigma^2 - sigma_c^2)
+	// - any other sigma is obtained in the same way from the closest cached image with a smaller sigma
+	//   (usually a grid level), so the additional blur is at most about one sub-octave step
+	// - levels of integer images are blurred and cached in float, and converted to the source depth
+	//   only on return, so that rounding errors do not accumulate along the chain of incremental blurs
+	// - at most 'max_bytes' of images are kept, and the least recently used ones are discarded first
+	// NOTE: returned images share data with the cache, clone them before modifying them
+	class GaussianScaleSpace
+	{
+		private:
+
+			// cached image
+			struct Level
+			{
+				double sigma;			// blur of the image
+				cv::Mat work;			// blurred image in working precision (float for integer images)
+				cv::Mat img;			// blurred image with the source depth (shares 'work' for float images)
+				long long last_use;		// time of last use
+			};
+
+			cv::Mat img;				// source image (sigma = 0)
+			std::vector<Level> levels;	// cached images
+			int levels_per_octave;		// grid levels per octave
+			size_t max_bytes;			// maximum memory used by the cached images
+			long long clock;			// time (= number of requests)
+			int n_hits;					// requests satisfied by a cached image
+			int n_misses;				// requests that required blurring
+
+			// memory used by a cached image
+			static size_t levelBytes(const Level & level);
+
+			// closest cached image with sigma <= 'sigma' (0 = none)
+			Level* closestBelow(double sigma);
+
+			// blur the closest cached image below 'sigma' and cache the result
+			Level & build(double sigma);
+
+			// cached image with blur 'sigma' (built if needed, together with the grid level below it)
+			Level & level(double sigma);
+
+		public:
+
+			GaussianScaleSpace(int _levels_per_octave = 4, size_t _max_bytes = size_t(256) << 20);
+
+			// set the source image and empty the cache
+			void setImage(const cv::Mat & _img);
+
+			// image blurred with a Gaussian of standard deviation 'sigma' (0 = source image)
+			// - for integer images this is the rounded float level, so each call has a single rounding error
+			cv::Mat blur(double sigma);
+
+			// difference of Gaussians (float) of the adjacent grid levels sigma and k sigma (k = 2^(1 / levels_per_octave)),
+			// divided by (k - 1) so that it approximates the scale-normalized Laplacian of Gaussian sigma^2 LoG
+			// - computed from the float levels, so it is not quantized for integer images either
+			cv::Mat differenceOfGaussians(double sigma);
+
+			// cache statistics
+			int hits() const { return n_hits; }
+			int misses() const { return n_misses; }
+			size_t memory() const;
+	};
+
+
+	// BILATERAL FILTERING
+	// approximations of cv::bilateralFilter whose cost does not depend on the kernel size: pixels
+	// are splatted on a coarse grid/lattice in the joint space-range domain, which is blurred and sliced
+	// back at the pixels, and the result normalized by the (equally blurred) weights
+	// - parameters are in the same order and units as cv::bilateralFilter (gray levels and pixels)
+	// - accuracy (PSNR vs. the exact filter) increases with 'sigma_space', and so does the speedup
+	// 8-bit, 16-bit and float images are supported
+
+	// bilateral grid (Paris & Durand, 2006) of single-channel images
+	// - cells are sigma_space x sigma_space pixels x sigma_color gray levels, so the grid is
+	//   (rows / sigma_space) x (cols / sigma_space) x (range / sigma_color) cells
+	// - grids over 512 MB (e.g. 16-bit images with small 'sigma_color') throw an aia::error
+	// - row bands are splatted in parallel on private sub-grids, then blurred and sliced in parallel
+	cv::Mat bilateralGrid(const cv::Mat & img, double sigma_color, double sigma_space);
+
+	// permutohedral lattice (Adams, Baek & Davis, 2010) of 1- or 3-channel images, whose memory
+	// and cost grow linearly (and not exponentially) with the dimensions of the space-range domain
+	// - lattice points are stored in a hash table, so splatting is sequential: blurring and slicing are parallel
+	// - color distances are Euclidean in the image color space, as in cv::bilateralFilter
+	cv::Mat bilateralPermutohedral(const cv::Mat & img, double sigma_color, double sigma_space);
+
+	// bilateral filter dispatcher
+	// - exact cv::bilateralFilter if 'sigma_space' < 'sigma_space_exact' (small kernels, where it is fast
+	//   and the approximations are less accurate), or if the image type is not supported
+	// - bilateral grid for single-channel images, permutohedral lattice for 3-channel images and for
+	//   single-channel images whose grid would exceed the memory cap of bilateralGrid
+	// - sigmas <= 0 are set to 1, as in cv::bilateralFilter
+	cv::Mat bilateral(const cv::Mat & img, double sigma_color, double sigma_space, double sigma_space_exact = 3.0);
+
+
+	// GUIDED FILTERING
+	// guided filter (He, Sun & Tang, 2013): edge-preserving smoothing whose output is, in each window,
+	// a linear transform of the guide fitted to the source (the box statistics of region growing:
+	// local means, variances and covariances of guide and source)
+	// - windows are (2 radius + 1) x (2 radius + 1), truncated at the image borders
+	// - 'eps' regularizes the fit and is in squared gray levels of the guide: structures whose local
+	//   variance is much larger than eps are preserved, much smaller ones are smoothed
+	//   (e.g. eps = 0.1^2 * 255^2 for 8-bit guides)
+	// - box means are computed with running sums, so the cost does not depend on 'radius'
+	// - all the box means of each step are computed in a single pass over row bands (in parallel), with
+	//   the products of guide and source computed on the fly: the only intermediate image is the one
+	//   of the linear coefficients
+	// - 'subsample' > 1: fast guided filter (He & Sun, 2015), coefficients are computed on images
+	//   downsampled by 'subsample' (with radius / subsample) and upsampled bilinearly, then applied to the guide
+	// guide: 1 or 3 channels; source: any number of channels (filtered independently), same size as the guide
+	// 8-bit, 16-bit and float images are supported, output has the same type as 'src'
+	cv::Mat guidedFilter(const cv::Mat & guide, const cv::Mat & src, int radius, double eps, int subsample = 1);
+
+	// self-guided filter ('img' is both the guide and the source)
+	cv::Mat guidedFilter(const cv::Mat & img, int radius, double eps, int subsample = 1);
+
+
+	// LOCAL STATISTICS
+	// local mean, variance and standard deviation of a single-channel image in ksize x ksize windows
+	// (centered as in cv::boxFilter, truncated at the image borders) from summed-area tables
+	// - the integral and squared integral images are built together in one pass, with 64-bit integers
+	//   for 8-bit and 16-bit images (exact) and doubles for float images
+	// - each query costs O(1) per pixel whatever the window size, so the tables are built once
+	//   and then queried with any number of window sizes
+	// - with a mask, only the pixels where the mask is nonzero are counted (statistics are 0
+	//   where the window contains none of them)
+	// 8-bit, 16-bit, float and double images are supported
+	class LocalStatistics
+	{
+		private:
+
+			int rows, cols;							// image size
+			std::vector<long long> int_sum;			// summed-area tables of 8-bit and 16-bit images
+			std::vector<long long> int_sq_sum;
+			std::vector<double> sum;				// summed-area tables of float images
+			std::vector<double> sq_sum;
+			std::vector<int> count;					// summed-area table of the mask (empty = no mask)
+
+			// stat = -1: all statistics (CV_32FC3), 0/1/2: only mean/variance/stdev (CV_32F)
+			cv::Mat compute(int ksize, int stat) const;
+
+		public:
+
+			LocalStatistics() : rows(0), cols(0) {}
+			LocalStatistics(const cv::Mat & img, const cv::Mat & mask = cv::Mat());
+
+			// build the summed-area tables of 'img' (and 'mask', 8-bit, if not empty)
+			void setImage(const cv::Mat & img, const cv::Mat & mask = cv::Mat());
+
+			// mean, variance and standard deviation as a CV_32FC3 image
+			cv::Mat statistics(int ksize) const;
+
+			// single statistics as CV_32F images
+			cv::Mat mean(int ksize) const;
+			cv::Mat variance(int ksize) const;
+			cv::Mat stdev(int ksize) const;
+
+			// statistics of the window centered on pixel (x, y), e.g. for region growing predicates
+			void at(int x, int y, int ksize, double & mean, double & variance) const;
+	};
+
+
+	// GRADIENT
+	// fused gradient of 8-bit single-channel images: 3x3 Sobel derivatives (as cv::Sobel, BORDER_REFLECT_101),
+	// magnitude, orientation and thresholding in a single pass over row bands (in parallel), with no
+	// intermediate images (derivatives in 16-bit integers, then float SIMD lanes, on a row at a time)
+	// - 'mag': 8-bit magnitude |g| * mag_scale (saturated); if 'mag_scale' <= 0 the magnitude is normalized
+	//   to [0, 255] by its maximum (found by a preliminary pass that only computes the derivatives)
+	// - 'angle': orientation atan2(dy, dx) in [0, 360) degrees (as cv::cartToPolar), quantized into 'angle_bins'
+	//   8-bit bins (bin = angle * angle_bins / 360); not computed if 'angle_bins' is 0
+	// - 'edges': binary mask (255) of pixels whose scaled magnitude (before rounding) is above 'threshold'
+	//   and whose orientation is in [alpha0, alpha1] (wrapped around 360 if alpha0 > alpha1, so that
+	//   e.g. [350, 10] selects near-horizontal gradients); not computed if 'threshold' < 0
+	void sobelGradient(const cv::Mat & img, cv::Mat & mag, cv::Mat & angle, cv::Mat & edges, double threshold = -1,
+		double mag_scale = 0, int angle_bins = 8, double alpha0 = 0, double alpha1 = 360);
+
+	// binary edges of the fused gradient (see above), e.g. for the Hough transform
+	cv::Mat sobelEdges(const cv::Mat & img, double threshold, double mag_scale = 0, double alpha0 = 0, double alpha1 = 360);
+
+
+	// ZERO CROSSINGS
+	// edges (255) of Marr-Hildreth detectors from a float second-derivative response (e.g. LoG or DoG):
+	// pixels where at least one of the 4 pairs of opposite 3x3 neighbors (N-S, W-E, NE-SW, NW-SE) has strictly
+	// opposite signs and an absolute difference >= 'threshold'
+	// - all 4 tests are computed with SIMD masks (no branches), row bands in parallel
+	// - the 1-pixel image border is set to 0
+	cv::Mat zeroCrossings(const cv::Mat & response, double threshold);
+
+
+	// CANNY
+	// Canny edges (255) of 8-bit single-channel images, same result as cv::Canny(img, edges, low, high, 3, L2gradient)
+	// on the image smoothed with a Gaussian of standard deviation 'sigma' (none if 'sigma' <= 0)
+	// - smoothing (BORDER_REPLICATE), Sobel gradient and non-maximum suppression are fused on row bands (in parallel),
+	//   with no intermediate images but the candidate map
+	// - hysteresis: 8-connected components of the candidates within each band (union-find, in parallel), merged
+	//   across band borders, then candidates are kept iff their component contains a candidate above 'high'
+	cv::Mat canny(const cv::Mat & img, double low, double high, double sigma = 0, bool L2gradient = false);
+
+
+	// GABOR FILTERING
+	// bank of complex Gabor filters (real part: cv::getGaborKernel with psi = 0, imaginary part: psi = pi/2)
+	// at 'n_orientations' orientations theta = k * pi / n_orientations, applied in the frequency domain
+	// - same result (up to float rounding) as cv::filter2D with each kernel (BORDER_REFLECT_101), with one
+	//   complex filter per orientation instead of two real ones
+	// - the kernel spectra are computed once for a given image size and cached, so the bank is reused
+	//   across images (e.g. video frames) of the same size; each channel is transformed only once
+	// - inverse transforms run in parallel over orientations, and the maximum magnitude and its
+	//   orientation are reduced on the fly (no per-orientation response images)
+	class GaborBank
+	{
+		private:
+
+			cv::Size ksize;					// kernel size
+			double sigma, lambd, gamma;		// kernel parameters (see cv::getGaborKernel)
+			int n_orientations;				// number of orientations
+			cv::Size img_size;				// image size the spectra were computed for (empty = none)
+			cv::Size dft_size;				// size of the transforms
+			std::vector<cv::Mat> spectra;	// DFTs (CV_32FC2) of the complex kernels, one per orientation
+
+			// compute the kernel spectra for images of size '_img_size' (if not already cached)
+			void prepare(cv::Size _img_size);
+
+		public:
+
+			GaborBank(cv::Size _ksize, double _sigma, int _n_orientations, double _lambd, double _gamma);
+
+			int orientations() const { return n_orientations; }
+			double theta(int k) const { return k * CV_PI / n_orientations; }
+
+			// real (or imaginary) part of the kernel of orientation k (CV_64F, as cv::getGaborKernel)
+			cv::Mat kernel(int k, bool imaginary = false) const;
+
+			// maximum magnitude of the complex responses over all orientations ('magnitude', float) and index
+			// of the orientation that achieves it ('orientation', 8-bit), with the same channels of 'img'
+			void filter(const cv::Mat & img, cv::Mat & magnitude, cv::Mat & orientation);
+	};
+
+
+	// MORPHOLOGY
+	// grayscale morphology with rectangular (flat) structuring elements of size 'ksize', same result as
+	// cv::morphologyEx with a MORPH_RECT element (default anchor and border)
+	// - separable van Herk/Gil-Werman algorithm: running max/min from prefix and suffix extrema within
+	//   blocks of the element size, i.e. about 3 comparisons per pixel per direction whatever the size
+	// - the vertical pass works on whole rows (SIMD), row bands in parallel
+	// - 'op': cv::MORPH_ERODE, MORPH_DILATE, MORPH_OPEN, MORPH_CLOSE, MORPH_GRADIENT, MORPH_TOPHAT or MORPH_BLACKHAT
+	// 8-bit, 16-bit and float images with any number of channels are supported
+	cv::Mat morphologyRect(const cv::Mat & img, int op, cv::Size ksize);
+	cv::Mat erodeRect(const cv::Mat & img, cv::Size ksize);
+	cv::Mat dilateRect(const cv::Mat & img, cv::Size ksize);
+
+	// grayscale morphology with (approximately) elliptical structuring elements, as cv::morphologyEx with a
+	// MORPH_ELLIPSE 'ksize' element, at a cost that does not depend on the element size
+	// - the ellipse is approximated by the Minkowski sum of 8 periodic lines (horizontal, vertical, diagonal
+	//   and knight's move directions: a 16-sided polygon) whose lengths fit the ellipse extent along every
+	//   direction, each one processed with the van Herk/Gil-Werman algorithm
+	// - elements smaller than 'exact_size' use the exact ellipse (cv::morphologyEx)
+	cv::Mat morphologyEllipse(const cv::Mat & img, int op, cv::Size ksize, int exact_size = 21);
+
+
+	// MORPHOLOGICAL RECONSTRUCTION
+	// binary reconstruction by dilation of 'marker' under 'mask' (8-bit, nonzero = foreground): the mask
+	// components (4- or 8-connected) that contain marker pixels, as 255
+	// - Vincent's FIFO algorithm: only the contour of the marker is queued, then each mask pixel is
+	//   reached (and queued) at most once, so the cost is linear in the number of pixels
+	cv::Mat reconstructBinary(const cv::Mat & marker, const cv::Mat & mask, int connectivity = 8);
+
+	// grayscale reconstruction by dilation of 'marker' under 'mask' (same size and type), i.e. geodesic
+	// dilations (4- or 8-connected) of min(marker, mask) iterated until stability
+	// - Vincent's hybrid algorithm: forward and backward raster scans, then FIFO propagation from the pixels
+	//   that can still change their neighbors; it stops when the queue is empty (no image comparisons)
+	// - channels are reconstructed independently, in parallel
+	// 8-bit, 16-bit and float images with any number of channels are supported
+	cv::Mat reconstructGrayscale(const cv::Mat & marker, const cv::Mat & mask, int connectivity = 8);
+
+	// binary image with its holes filled, i.e. the background regions ('connectivity'-connected)
+	// that cannot be reached from the image border
+	cv::Mat fillHoles(const cv::Mat & img, int connectivity = 4);
+
+	// binary image without the foreground components that touch the image border
+	cv::Mat clearBorder(const cv::Mat & img, int connectivity = 8);
+
+	// binary opening by reconstruction: foreground components where the 'ksize' rectangle fits
+	// (marker = erosion, see erodeRect), reconstructed whole
+	cv::Mat openingByReconstruction(const cv::Mat & img, cv::Size ksize, int connectivity = 8);
+
+
+	// BINARY IMAGES
+	// binary image packed at 1 bit per pixel (64 pixels per word), for binary pipelines that are
+	// memory-bound on 8-bit 0/255 masks (e.g. iterative thinning and its convergence checks)
+	// - conversions from/to cv::Mat pack 16 pixels per SIMD comparison and unpack 8 pixels per table lookup
+	// - logical operations, counts (popcount) and differences work on whole words
+	// - morphology is word-parallel: 3x3 elements shift each word by one bit (carrying the bits of the
+	//   neighbor words), wider rectangles OR runs of doubling length along rows (O(log width) word operations)
+	//   and van Herk/Gil-Werman prefix/suffix ORs across rows; hit-or-miss ANDs shifted (complemented) rows
+	// - pixels outside the image never change the result, as in cv::erode, cv::dilate and MORPH_HITMISS
+	// - row bands are processed in parallel
+	class BinaryImage
+	{
+		private:
+
+			int rows, cols;					// image size
+			int words;						// 64-bit words per row (bits beyond 'cols' are always 0)
+			std::vector<uint64_t> bits;		// rows one after another, pixel x is bit x % 64 of word x / 64
+
+			// erosion (dilation of the complement, complemented) or dilation with a rectangle
+			BinaryImage morphRect(cv::Size ksize, bool erode) const;
+			BinaryImage morph3x3(bool erode) const;
+
+			// set the bits beyond 'cols' back to 0
+			void clearPadding();
+
+			// precondition check of the operations between two images
+			void checkSize(const BinaryImage & other, const char* op) const;
+
+		public:
+
+			BinaryImage() : rows(0), cols(0), words(0) {}
+			BinaryImage(int _rows, int _cols, bool value = false);
+
+			// pack a single-channel image (nonzero = 1)
+			explicit BinaryImage(const cv::Mat & img);
+
+			// unpack to an 8-bit image (0/255)
+			cv::Mat toMat() const;
+
+			cv::Size size() const { return cv::Size(cols, rows); }
+			bool empty() const { return rows == 0 || cols == 0; }
+			bool at(int x, int y) const { return (bits[y * words + x / 64] >> (x % 64)) & 1; }
+			void set(int x, int y, bool value);
+
+			// logical operations between images of the same size ('-' = set difference, as the saturated
+			// subtraction of 0/255 images)
+			BinaryImage operator~() const;
+			BinaryImage operator&(const BinaryImage & other) const;
+			BinaryImage operator|(const BinaryImage & other) const;
+			BinaryImage operator^(const BinaryImage & other) const;
+			BinaryImage operator-(const BinaryImage & other) const;
+			BinaryImage & operator&=(const BinaryImage & other);
+			BinaryImage & operator|=(const BinaryImage & other);
+			BinaryImage & operator^=(const BinaryImage & other);
+			BinaryImage & operator-=(const BinaryImage & other);
+			bool operator==(const BinaryImage & other) const;
+			bool operator!=(const BinaryImage & other) const { return !(*this == other); }
+
+			// image translated by (dx, dy), i.e. pixel (x, y) moves to (x + dx, y + dy); the uncovered
+			// pixels are set to 'fill'
+			BinaryImage shift(int dx, int dy, bool fill = false) const;
+
+			// erosion and dilation with a 'ksize' rectangle (anchor at the center), as cv::erode / cv::dilate
+			BinaryImage erode(cv::Size ksize = cv::Size(3, 3)) const;
+			BinaryImage dilate(cv::Size ksize = cv::Size(3, 3)) const;
+
+			// hit-or-miss transform, as cv::morphologyEx with MORPH_HITMISS: 'kernel' (8-bit or 32-bit signed
+			// integers, any size, anchor at the center) has 1 = foreground, -1 = background, 0 = don't care
+			BinaryImage hitOrMiss(const cv::Mat & kernel) const;
+
+			// number of foreground pixels
+			long long count() const;
+
+			// number of pixels that differ from 'other' (popcount of the xor, with no temporary image),
+			// e.g. for the convergence checks of iterative algorithms
+			long long countDifferent(const BinaryImage & other) const;
+	};
+}
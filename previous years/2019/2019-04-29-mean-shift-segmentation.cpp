@@ -2,6 +2,9 @@
 #include "aiaConfig.h"
 #include "ucasConfig.h"
 
+// include my project functions
+#include "functions.h"
+
 namespace aia
 {
 	// local (8-neighborhood) region-growing segmentation based on color difference
@@ -36,8 +39,8 @@ int main()
 		cv::cvtColor(img_ms, img_ms, cv::COLOR_BGR2GRAY);
 		aia::imshow("Grayscale", img_ms);
 
-		// median blur
-		cv::medianBlur(img_ms, img_ms, 21);
+		// median blur (constant-time histogram method, see aia::median)
+		img_ms = aia::median(img_ms, 21);
 		aia::imshow("Median", img_ms);
 
 		// select top-right connected component
@@ -7,12 +7,13 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+// include my project functions
+#include "functions.h"
+
 cv::Mat claheq(const cv::Mat & img_mono, int n_tiles = 8)
 {
-	cv::Ptr<cv::CLAHE> algo = cv::createCLAHE(40, cv::Size(n_tiles, n_tiles));
-	cv::Mat img_eq;
-	algo->apply(img_mono, img_eq);
-	return img_eq;
+	// same result as cv::CLAHE on 8-bit images, but also works natively on 16-bit images
+	return aia::clahe(img_mono, 40, cv::Size(n_tiles, n_tiles));
 }
 
 int main() 
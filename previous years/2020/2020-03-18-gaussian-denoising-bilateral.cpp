@@ -7,6 +7,9 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+// include my project functions
+#include "functions.h"
+
 namespace
 {
 	cv::Mat img;
@@ -18,6 +21,8 @@ namespace
 	int median_filter_size = 3;
 	int bilateral_sigma_r_x10 = 10;
 	int bilateral_sigma_s_x10 = 10;
+	int guided_radius = 4;
+	int guided_eps_x100 = 10;		// eps = (guided_eps_x100 / 100 * 255)^2
 	std::string win_name;
 
 	void gaussianNoiseReduction(int pos, void* userdata)
@@ -35,9 +40,14 @@ namespace
 		cv::imshow("With noise", img_noised);
 		cv::imshow("Denoised with median filtering", img_denoised);
 
-		// denoising with bilateral filtering
-		cv::bilateralFilter(img_noised, img_denoised, 0, bilateral_sigma_r_x10/10.0, bilateral_sigma_s_x10/10.0f);
+		// denoising with bilateral filtering (bilateral grid for large sigma_s)
+		img_denoised = aia::bilateral(img_noised, bilateral_sigma_r_x10/10.0, bilateral_sigma_s_x10/10.0);
 		cv::imshow("Denoised with bilateral filtering", img_denoised);
+
+		// denoising with (self-)guided filtering
+		double guided_eps = guided_eps_x100 / 100.0 * 255;
+		img_denoised = aia::guidedFilter(img_noised, std::max(1, guided_radius), std::max(1.0, guided_eps * guided_eps));
+		cv::imshow("Denoised with guided filtering", img_denoised);
 	}
 }
 
@@ -45,6 +55,26 @@ int main()
 {
 	try
 	{
+		// accuracy (PSNR) and speed of the bilateral grid (grayscale) and of the permutohedral lattice (color)
+		// w.r.t. the exact bilateral filter
+		for (int color = 0; color <= 1; color++)
+		{
+			cv::Mat lena = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/lena.png", color ? CV_LOAD_IMAGE_COLOR : CV_LOAD_IMAGE_GRAYSCALE);
+			for (double sigma_s : {3, 5, 10, 20})
+				for (double sigma_r : {10, 30})
+				{
+					ucas::Timer timer;
+					cv::Mat exact;
+					cv::bilateralFilter(lena, exact, 0, sigma_r, sigma_s);
+					float exact_ms = timer.elapsed<float>() * 1000;
+					timer.restart();
+					cv::Mat approx = color ? aia::bilateralPermutohedral(lena, sigma_r, sigma_s) : aia::bilateralGrid(lena, sigma_r, sigma_s);
+					float approx_ms = timer.elapsed<float>() * 1000;
+					printf("%s sigma_s = %2.0f, sigma_r = %2.0f: exact %7.1f ms, %s %5.1f ms, PSNR %.1f dB\n",
+						color ? "color" : "gray ", sigma_s, sigma_r, exact_ms, color ? "lattice" : "grid   ", approx_ms, cv::PSNR(exact, approx));
+				}
+		}
+
 		img = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/lena.png", CV_LOAD_IMAGE_GRAYSCALE);
 		
 		img_float = img.clone();
@@ -59,6 +89,8 @@ int main()
 		cv::createTrackbar("median-filter", win_name, &median_filter_size, 100, gaussianNoiseReduction);
 		cv::createTrackbar("bilateral-sigma-r", win_name, &bilateral_sigma_r_x10, 300, gaussianNoiseReduction);
 		cv::createTrackbar("bilateral-sigma-s", win_name, &bilateral_sigma_s_x10, 300, gaussianNoiseReduction);
+		cv::createTrackbar("guided-radius", win_name, &guided_radius, 50, gaussianNoiseReduction);
+		cv::createTrackbar("guided-eps", win_name, &guided_eps_x100, 100, gaussianNoiseReduction);
 
 		gaussianNoiseReduction(0, 0);
 		cv::waitKey(0);
@@ -14,115 +14,35 @@ namespace eiid
 
 	bool adaptive_HE = false;	// whether adaptive histogram equalization (HE) should be applied instead of global HE
 	int block_size = 8;			// tile/block size used for adaptive HE
+	int clip_limit = 40;		// clip limit used for adaptive HE
+
+	// histogram equalizer: intermediate results (luminance channel, histograms, LUTs) are cached
+	// and recomputed only when the parameters they depend on change, so that moving the
+	// trackbars does not redo the whole processing every time
+	aia::HistogramEqualizer equalizer;
 
 	// NOTE: this is a callback function we will link to the trackbars in the GUI
 	//       all trackbar callback functions must have the prototype (int, void*)
 	//       see http://docs.opencv.org/2.4/modules/highgui/doc/user_interface.html?highlight=createtrackbar
 	void histogramEqualizationCallback(int pos, void* userdata) 
 	{
-		// precondition checks
-		if(img.channels() != 1 && img.channels() != 3)
-		{
-			printf("image has %d channel, only 1- and 3-channel image are supported", img.channels());
-			return;
-		}
-		if(img.depth() != CV_8U && img.depth() != CV_16U)
-		{
-			printf("unsupported pixel type (only 8- and 16-bit unsigned are supported)");
-			return;
-		}
-		if(!img.data)
-		{
-			printf("image data empty");
-			return;
-		}
-
-		// from now on, we operate on a clone of the original image
-		// so that we can call this function multiple times with
-		// different settings
-		cv::Mat img_cpy = img.clone();
-
-		// automatically detect the number of gray levels
-		int L = std::pow(2, ucas::imdepth_detect(img_cpy));
-
-		// we apply HE on the luminance channel only
-		// if the image is grayscale, the luminance channel is the image itself
-		// otherwise we have to extract is using an appropriate colorspace conversion
-		cv::Mat img_lum;
-		if(img_cpy.channels() == 3)
-		{
-			// here we use the Lab colorspace, but HSV is also a valid option
-			cv::cvtColor(img_cpy, img_cpy, cv::COLOR_BGR2Lab);
-			std::vector <cv::Mat> img_channels;
-			cv::split(img_cpy, img_channels);
-
-			img_lum = img_channels[0];
-		}
-		else
-			img_lum = img_cpy;
-
-
 		// global histogram equalization
+		// NOTE: OpenCV does have a 'equalizeHist' function, but it only supports 8-bit images
+		// whereas we here support both 8- and 16-bit images
+		cv::Mat img_eq;
 		if(adaptive_HE == false)
-		{
-			// calculate histogram using as many bins as the number of graylevels
-			std::vector <int> histo = ucas::histogram(img_lum, L);
-
-			// calculate cumulative distribution function using the above calculated histogram
-			int acc = 0;
-			std::vector <int> cdf(histo.size());
-			for(int i=0; i<histo.size(); i++)
-			{
-				acc += histo[i];
-				cdf[i] = acc;
-			}
-
-			// apply histogram equalization
-			// NOTE: OpenCV does have a 'equalizeHist' function, but it only supports 8-bit images
-			// whereas we here support both 8- and 16-bit images
-			float left_term = float(L-1)/(img_lum.rows * img_lum.cols);
-			if(img_lum.depth() == CV_8U)
-			{
-				for(int y=0; y<img_lum.rows; y++)
-				{
-					unsigned char* data_row = img_lum.ptr<unsigned char>(y);
-					for(int x=0; x<img_lum.cols; x++)
-						data_row[x] = left_term*cdf[data_row[x]];
-				}
-			}
-			else
-			{
-				for(int y=0; y<img_lum.rows; y++)
-				{
-					unsigned short* data_row = img_lum.ptr<unsigned short>(y);
-					for(int x=0; x<img_lum.cols; x++)
-						data_row[x] = left_term*cdf[data_row[x]];
-				}
-			}
-		}
-		// adaptive histogram equalization
+			img_eq = equalizer.equalize();
+		// adaptive histogram equalization (CLAHE, also on 16-bit images)
 		else
 		{
-			// instance and apply CLAHE algorithm
-			cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE();
-			clahe->setTilesGridSize(cv::Size(img_lum.cols/block_size, img_lum.rows/block_size));
-			clahe->apply(img_lum, img_lum);
-		}
-
-		// if image is 3-channels, split img_cpy again and set the new luminance channel,
-		// then merge and set the original colorspace back
-		if(img_cpy.channels() == 3)
-		{
-			std::vector <cv::Mat> img_channels;
-			cv::split(img_cpy, img_channels);
-			img_channels[0] = img_lum;
-			cv::merge(img_channels, img_cpy);
-			cv::cvtColor(img_cpy, img_cpy, cv::COLOR_Lab2BGR);
+			int tile_size = std::max(block_size, 1);
+			img_eq = equalizer.equalizeAdaptive(cv::Size(img.cols/tile_size, img.rows/tile_size), clip_limit);
 		}
 		
 		// show enhanced image and the corresponding histogram
-		cv::imshow("histogram equalization", img_cpy);
-		cv::imshow("histogram", ucas::imhist(img_lum));
+		cv::imshow("histogram equalization", img_eq);
+		// (the histogram is cached by the equalizer along with the result)
+		cv::imshow("histogram", aia::imhist(equalizer.luminanceHistogram()));
 	}
 }
 
@@ -153,17 +73,17 @@ int main()
 			cv::resize(eiid::img, eiid::img, cv::Size(0,0), 0.2, 0.2);
 			// 2) rescale from 14-bits to 16-bits
 			cv::normalize(eiid::img, eiid::img, 0, 65535, cv::NORM_MINMAX);
-			// 3) transform from 16-bits to 8-bits if CLAHE is used (16-bits not supported!)
-			if(eiid::adaptive_HE)
-			{
-				cv::normalize(eiid::img, eiid::img, 0, 255, cv::NORM_MINMAX);
-				eiid::img.convertTo(eiid::img, CV_8U);
-			}
 		}
 
+		// we apply HE on the luminance channel only (automatically detecting the number of gray levels):
+		// if the image is grayscale, the luminance channel is the image itself, otherwise the equalizer
+		// extracts it using an appropriate colorspace conversion
+		eiid::equalizer.setImage(eiid::img, std::pow(2, ucas::imdepth_detect(eiid::img)));
+
 		// create the window and insert the trackbar
 		cv::namedWindow("histogram equalization");
 		cv::createTrackbar("block_size", "histogram equalization", &eiid::block_size, 256, eiid::histogramEqualizationCallback);
+		cv::createTrackbar("clip_limit", "histogram equalization", &eiid::clip_limit, 100, eiid::histogramEqualizationCallback);
 		
 		// call function with default parameters so it is updated right after the app starts
 		eiid::histogramEqualizationCallback(0,0);
@@ -73,7 +73,7 @@ namespace eiid
 		if(percentile_mode)
 		{
 			// the histogram is required to calculate percentiles...
-			std::vector <int> histo = ucas::histogram(img_lum);
+			std::vector <int> histo = aia::histogram(img_lum);
 
 			// ...along with an accumulator
 			int acc = 0;
@@ -101,17 +101,9 @@ namespace eiid
 		}
 
 		// apply piecewise (N=3) linear stretching
-		for(int y=0; y<img_lum.rows; y++)
-		{
-			unsigned char* data_row = img_lum.ptr<unsigned char>(y);
-			for(int x=0; x<img_lum.cols; x++)
-				if(data_row[x] <= s1)
-					data_row[x] = float(data_row[x] - 0)  * (t1  - 0 )/(s1 -  0)  + 0;
-				else if(data_row[x] > s1 && data_row[x] <= s2)
-					data_row[x] = float(data_row[x] - s1) * (t2  - t1)/(s2 -  s1) + t1;
-				else
-					data_row[x] = float(data_row[x] - s2) * (255 - t2)/(255 - s2) + t2;
-		}
+		// the transform is evaluated once per gray level and stored in a lookup table
+		std::vector <cv::Point2f> points = {cv::Point2f(0, 0), cv::Point2f(s1, t1), cv::Point2f(s2, t2), cv::Point2f(255, 255)};
+		aia::applyLUT(img_lum, aia::piecewiseLinearLUT(CV_8U, points), img_lum);
 
 		// if image is 3-channels, split img_cpy again and set the new luminance channel,
 		// then merge and set the original colorspace back
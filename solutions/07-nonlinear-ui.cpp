@@ -62,52 +62,16 @@ namespace eiid
 			img_lum = img_cpy;
 
 
-		// logarithmic transform (8- and 16-bit versions)
+		// logarithmic transform or gamma correction (8- and 16-bit versions)
+		// the transform is evaluated once per gray level and stored in a lookup table
+		// (the histogram of the result is calculated in the same pass)
+		cv::Mat lut;
 		if(gamma_correction == false)
-		{
-			float c = (L-1)/log(L);
-			if(img_lum.depth() == CV_8U)
-			{
-				for(int y=0; y<img_lum.rows; y++)
-				{
-					unsigned char* data_row = img_lum.ptr<unsigned char>(y);
-					for(int x=0; x<img_lum.cols; x++)
-						data_row[x] = c*log(1+data_row[x]);
-				}
-			}
-			else
-			{
-				for(int y=0; y<img_lum.rows; y++)
-				{
-					unsigned short* data_row = img_lum.ptr<unsigned short>(y);
-					for(int x=0; x<img_lum.cols; x++)
-						data_row[x] = c*log(1+data_row[x]);
-				}
-			}
-		}
-		// gamma correction (8- and 16-bit versions)
+			lut = aia::logLUT(img_lum.depth(), L);
 		else
-		{
-			float c = std::pow(L-1, 1-gammaX100/100.0f);
-			if(img_lum.depth() == CV_8U)
-			{
-				for(int y=0; y<img_lum.rows; y++)
-				{
-					unsigned char* data_row = img_lum.ptr<unsigned char>(y);
-					for(int x=0; x<img_lum.cols; x++)
-						data_row[x] = c*std::pow(data_row[x], gammaX100/100.0f);
-				}
-			}
-			else
-			{
-				for(int y=0; y<img_lum.rows; y++)
-				{
-					unsigned short* data_row = img_lum.ptr<unsigned short>(y);
-					for(int x=0; x<img_lum.cols; x++)
-						data_row[x] = c*std::pow(data_row[x], gammaX100/100.0f);
-				}
-			}
-		}
+			lut = aia::gammaLUT(img_lum.depth(), gammaX100/100.0f, L);
+		std::vector <int> histo;
+		aia::applyLUT(img_lum, lut, img_lum, histo);
 
 		// if image is 3-channels, split img_cpy again and set the new luminance channel,
 		// then merge and set the original colorspace back
@@ -122,7 +86,7 @@ namespace eiid
 
 		// show enhanced image and the corresponding histogram
 		cv::imshow("nonlinear enhancement", img_cpy);
-		cv::imshow("histogram", ucas::imhist(img_lum));
+		cv::imshow("histogram", aia::imhist(histo));
 	}
 }
 
@@ -153,6 +117,11 @@ int main()
 			cv::resize(eiid::img, eiid::img, cv::Size(0,0), 0.2, 0.2);
 			// 2) rescale from 14-bits to 16-bits
 			cv::normalize(eiid::img, eiid::img, 0, 65535, cv::NORM_MINMAX);
+			// 3) optionally remove noise with a 7x7 median, working directly on 16-bit data
+			//    (disabled by default, since it changes the enhanced image)
+			bool denoise = false;
+			if (denoise)
+				eiid::img = aia::median(eiid::img, 7);
 		}
 
 		// create the window and insert the trackbar
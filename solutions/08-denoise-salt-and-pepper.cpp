@@ -46,7 +46,7 @@ namespace eiid
 		// 
 		cv::Mat img_denoised;
 		if(eiid::median)
-			cv::medianBlur(img_noise, img_denoised, filter_size);
+			img_denoised = aia::median(img_noise, filter_size);
 		else
 			cv::GaussianBlur(img_noise, img_denoised, cv::Size(filter_size, filter_size), 0, 0);
 
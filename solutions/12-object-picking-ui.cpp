@@ -57,13 +57,13 @@ int main()
 		// binarize the image
 		cv::Mat img_gray;
 		cv::cvtColor(img, img_gray, cv::COLOR_BGR2GRAY);
-		std::vector <int> histo = ucas::histogram(img_gray);
+		std::vector <int> histo = aia::histogram(img_gray);
 		int T = ucas::getTriangleAutoThreshold(histo);
 		cv::threshold(img_gray, img_gray, T, 255, cv::THRESH_BINARY);
 		ucas::imshow("binarized", img_gray);
 
 		// remove binarization artifacts
-		cv::medianBlur(img_gray, img_gray, 7);
+		img_gray = aia::median(img_gray, 7);
 		ucas::imshow("binarized + median", img_gray);
 
 		// connected component extraction
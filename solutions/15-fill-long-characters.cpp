@@ -45,32 +45,40 @@ int main()
 		// Morphological reconstruction by conditional dilation:
 		// iteratively dilate the marker 'F' under the constraint 'F' ? 'G'
 		// ...until 'F' does not change anymore (reached stability = reconstruction ended)
+		// animate = true shows the iterative conditional dilations, otherwise the reconstruction is computed
+		// at once with the FIFO algorithm (linear in the number of pixels)
+		bool animate = false;
 		cv::Mat marker_prev;	
-		do 
+		if (animate)
 		{
-			// we keep a 'copy' of the previous marker (i.e. before the ith conditional dilation)
-			marker_prev = marker.clone();
-
-			// dilation...
-			cv::dilate(marker, marker, cv::getStructuringElement(CV_SHAPE_RECT, cv::Size(3,3)));
-			//                                                        /\
-			//                                                        || see final comment and try to use a CV_SHAPE_CROSS instead
-
-			// ...under the constraint 'F' ? 'G'
-			marker = marker & img_bin;
-
-			// display intermediate results with a delay of 200ms between two iterations
-			cv::imshow("Reconstruction (in progress)", marker);
-			if (cv::waitKey(200)>=0)
-				cv::destroyWindow("Reconstruction (in progress)");
-
-		} while (cv::countNonZero(marker - marker_prev) > 0);
-		//                 /\
-		//                 || counts the number of pixels different than '0'
-		//                 || 'marker - marker_prev' contains at least one nonzero pixel if (and only if)
-		//                    'marker' and 'marker_prev' are not equal, i.e. if 'marker_prev' has changed
-		//                    so this conditions reads 'go on while the marker keeps changing' or
-		//                    'stop when the marker does not change anymore
+			do 
+			{
+				// we keep a 'copy' of the previous marker (i.e. before the ith conditional dilation)
+				marker_prev = marker.clone();
+
+				// dilation...
+				cv::dilate(marker, marker, cv::getStructuringElement(CV_SHAPE_RECT, cv::Size(3,3)));
+				//                                                        /\
+				//                                                        || see final comment and try to use a CV_SHAPE_CROSS instead
+
+				// ...under the constraint 'F' ? 'G'
+				marker = marker & img_bin;
+
+				// display intermediate results with a delay of 200ms between two iterations
+				cv::imshow("Reconstruction (in progress)", marker);
+				if (cv::waitKey(200)>=0)
+					cv::destroyWindow("Reconstruction (in progress)");
+
+			} while (cv::countNonZero(marker - marker_prev) > 0);
+			//                 /\
+			//                 || counts the number of pixels different than '0'
+			//                 || 'marker - marker_prev' contains at least one nonzero pixel if (and only if)
+			//                    'marker' and 'marker_prev' are not equal, i.e. if 'marker_prev' has changed
+			//                    so this conditions reads 'go on while the marker keeps changing' or
+			//                    'stop when the marker does not change anymore
+		}
+		else
+			marker = aia::reconstructBinary(marker, img_bin);
 
 		aia::imshow("Reconstruction (result)", marker);
 		// NOTE: the result may erroneously detected/reconstructed 'a' characters close to 't', since
@@ -86,23 +94,28 @@ int main()
 		ucas::imshow("Hole filling (marker)", marker);
 		cv::Mat mask = 255 - img;
 		ucas::imshow("Hole filling (mask)", mask);
-		do 
+		if (animate)
 		{
-			// we keep a 'copy' of the previous marker (i.e. before the ith conditional dilation)
-			marker_prev = marker.clone();
-
-			// dilation...
-			cv::dilate(marker, marker, cv::getStructuringElement(CV_SHAPE_RECT, cv::Size(3,3)));
-
-			// ...under the constraint 'F' ? 'G'
-			marker = marker & mask;
-
-			// display intermediate results with a delay of 50ms between two iterations
-			cv::imshow("Hole filling (in progress)", marker);
-			if (cv::waitKey(50)>=0)
-				cv::destroyWindow("Hole filling (in progress)");
-
-		} while (cv::countNonZero(marker - marker_prev) > 0);
+			do 
+			{
+				// we keep a 'copy' of the previous marker (i.e. before the ith conditional dilation)
+				marker_prev = marker.clone();
+
+				// dilation...
+				cv::dilate(marker, marker, cv::getStructuringElement(CV_SHAPE_RECT, cv::Size(3,3)));
+
+				// ...under the constraint 'F' ? 'G'
+				marker = marker & mask;
+
+				// display intermediate results with a delay of 50ms between two iterations
+				cv::imshow("Hole filling (in progress)", marker);
+				if (cv::waitKey(50)>=0)
+					cv::destroyWindow("Hole filling (in progress)");
+
+			} while (cv::countNonZero(marker - marker_prev) > 0);
+		}
+		else
+			marker = aia::reconstructBinary(marker, mask);	// i.e. 255 - aia::fillHoles(img, 8)
 
 		ucas::imshow("Hole filling (result)", 255-marker);
 
@@ -19,6 +19,7 @@ namespace aia
 	// the images we need to keep in memory
 	cv::Mat img;            // original image
 	cv::Mat imgEdges;       // binary image after edge detection
+	GaussianScaleSpace scale_space;	// smoothed images of 'img', cached so that only changing sigma requires blurring
 
 	// parameters of edge detection
 	int stdevX10;           // standard deviation of the gaussian smoothing applied as denoising prior to the calculation of the image derivative
@@ -39,43 +40,17 @@ namespace aia
 	// see http://docs.opencv.org/2.4/modules/highgui/doc/user_interface.html?highlight=createtrackbar
 	void edgeDetectionGrad(int, void*)
 	{
-		// if 'stdevX10' is valid, we apply gaussian smoothing
-		if(stdevX10 > 0)
-			cv::GaussianBlur(img, imgEdges, cv::Size(0,0), (stdevX10/10.0), (stdevX10/10.0));
-		// otherwise we simply clone the image as it is
-		else
-			imgEdges = img.clone();
-		// NOTE: we store the result into 'imgEdges', that we will re-use after
-		//       in this way we can avoid allocating multiple cv::Mat and make the processing faster
-
-		// compute first-order derivatives along X and Y
-		cv::Mat img_dx, img_dy;
-		cv::Sobel(imgEdges, img_dx, CV_32F, 1, 0);
-		cv::Sobel(imgEdges, img_dy, CV_32F, 0, 1);
+		// gaussian smoothing (if 'stdevX10' is 0, we simply take the image as it is)
+		cv::Mat img_smoothed = scale_space.blur(stdevX10/10.0);
 
-		// compute gradient magnitude and angle
-		cv::Mat mag, angle;
-		cv::cartToPolar(img_dx, img_dy, mag, angle, true);
-
-		// generate a binary image from gradient magnitude and angle matrices
+		// generate a binary image from gradient magnitude and angle
 		// how?
 		// - take pixels whose gradient magnitude is higher than the specified threshold
 		//   AND
-		// - take pixels whose angle is within the specified range
-		for(int y=0; y<imgEdges.rows; y++)
-		{
-			aia::uint8* imgEdgesYthRow = imgEdges.ptr<aia::uint8>(y); 
-			float* magYthRow = mag.ptr<float>(y); 
-			float* angleYthRow = angle.ptr<float>(y); 
-
-			for(int x=0; x<imgEdges.cols; x++)
-			{
-				if(magYthRow[x] > threshold && (angleYthRow[x] >= alpha0 || angleYthRow[x] <= alpha1))
-					imgEdgesYthRow[x] = 255;
-				else
-					imgEdgesYthRow[x] = 0;
-			}
-		}
+		// - take pixels whose angle is within the specified range [alpha0, alpha1] (wrapped around 360)
+		// derivatives along X and Y, magnitude, angle and thresholding are all computed in one pass
+		// NOTE: we store the result into 'imgEdges', that we will re-use after
+		imgEdges = aia::sobelEdges(img_smoothed, threshold, 1.0, alpha0, alpha1);
 
 		cv::imshow("Edge detection (gradient)", imgEdges);
 	}
@@ -143,6 +118,7 @@ int main()
 		aia::img = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/road.jpg", CV_LOAD_IMAGE_GRAYSCALE);
 		if(!aia::img.data)
 			throw aia::error("Cannot open image");
+		aia::scale_space.setImage(aia::img);
 
 		// set default parameters
 		aia::stdevX10 = 10;
@@ -28,8 +28,8 @@ int main()
 		// in this example, we are interested to stars
 		// thus, opening the image with a circular SE of diameter slightly larger than the biggest star
 		// will remove stars / shave the peaks
-		cv::Mat marker;
-		cv::morphologyEx(img, marker, CV_MOP_OPEN, cv::getStructuringElement(CV_SHAPE_ELLIPSE, cv::Size(30,30)));
+		// NOTE: the disk is approximated by a sequence of periodic lines, so the cost does not depend on its size
+		cv::Mat marker = aia::morphologyEllipse(img, cv::MORPH_OPEN, cv::Size(30,30));
 		aia::imshow("Marker", marker);
 		//cv::imwrite(std::string(EXAMPLE_IMAGES_PATH) + "/galaxy_marker.jpg", marker);
 
@@ -37,31 +37,42 @@ int main()
 		// Morphological reconstruction by conditional dilation:
 		// iteratively dilate the marker 'F' under the constraint 'F' <= 'G'
 		// ...until 'F' does not change anymore (reached stability = reconstruction ended)
-		cv::Mat marker_prev;	// we need to store the previous marker in the iteration
-		std::vector<cv::Mat> marker_split, marker_split_prec;	// and do the same for each channel since here we deal with a color image
-		int it = 0;
-		do
+		// animate = true prints the iterations of conditional dilation, otherwise the reconstruction is computed
+		// at once with the hybrid algorithm (raster scans + FIFO, channels in parallel, no image comparisons)
+		// NOTE: the hybrid algorithm propagates between 8-connected neighbors, whereas the 5x5 geodesic steps
+		//       also jump over mask valleys up to 1 pixel wide, so the two results (and the output of this
+		//       program compared to the iterative version) can differ
+		bool animate = false;
+		if (animate)
 		{
-			// make a backup copy of the previous marker
-			marker_prev = marker.clone();
+			cv::Mat marker_prev;	// we need to store the previous marker in the iteration
+			std::vector<cv::Mat> marker_split, marker_split_prec;	// and do the same for each channel since here we deal with a color image
+			int it = 0;
+			do
+			{
+				// make a backup copy of the previous marker
+				marker_prev = marker.clone();
 
-			// geodesic dilation ( = dilation + pointwise minimum with mask)
-			cv::morphologyEx(marker, marker, CV_MOP_DILATE, cv::getStructuringElement(CV_SHAPE_RECT, cv::Size(5,5)));
-			marker = cv::min(marker, img);
+				// geodesic dilation ( = dilation + pointwise minimum with mask)
+				cv::morphologyEx(marker, marker, CV_MOP_DILATE, cv::getStructuringElement(CV_SHAPE_RECT, cv::Size(5,5)));
+				marker = cv::min(marker, img);
 
-			// display reconstruction in progress
-			printf("it = %d\n", ++it);
-			//aia::imshow("marker", marker);
+				// display reconstruction in progress
+				printf("it = %d\n", ++it);
+				//aia::imshow("marker", marker);
 
-			// *** ONLY FOR COLOR MORPHOLOGICAL RECONSTRUCTION ***
-			// split channels
-			cv::split(marker, marker_split);
-			cv::split(marker_prev, marker_split_prec);
+				// *** ONLY FOR COLOR MORPHOLOGICAL RECONSTRUCTION ***
+				// split channels
+				cv::split(marker, marker_split);
+				cv::split(marker_prev, marker_split_prec);
+			}
+			while( cv::countNonZero(marker_split[0]-marker_split_prec[0]) > 0 ||
+				   cv::countNonZero(marker_split[1]-marker_split_prec[1]) > 0 ||
+				   cv::countNonZero(marker_split[2]-marker_split_prec[2]) > 0) ;
+				 // check for each channel if there are any changes
 		}
-		while( cv::countNonZero(marker_split[0]-marker_split_prec[0]) > 0 ||
-			   cv::countNonZero(marker_split[1]-marker_split_prec[1]) > 0 ||
-			   cv::countNonZero(marker_split[2]-marker_split_prec[2]) > 0) ;
-			 // check for each channel if there are any changes
+		else
+			marker = aia::reconstructGrayscale(marker, img, 8);
 
 
 		aia::imshow("Reconstructed", marker);
@@ -14,6 +14,7 @@ namespace aia
 {
 	// the images we need to keep in memory
 	cv::Mat img;				// original image
+	GaussianScaleSpace scale_space;	// smoothed images of 'img', shared by all detectors and cached across callbacks
 
 	// parameters of gradient-based edge detection
 	int sigmaGradX10;           // standard deviation of the gaussian smoothing applied as denoising prior to the calculation of the image derivative
@@ -36,39 +37,14 @@ namespace aia
 	// see http://docs.opencv.org/2.4/modules/highgui/doc/user_interface.html?highlight=createtrackbar
 	void edgeDetectionGrad(int, void*)
 	{
-		cv::Mat imgEdges;       // we will store here the binary image after edge detection to be displayed
-
-		// if 'sigmaGradX10' is valid, we apply gaussian smoothing
-		if(sigmaGradX10 > 0)
-			cv::GaussianBlur(img, imgEdges, cv::Size(0,0), (sigmaGradX10/10.0), (sigmaGradX10/10.0));
-		// otherwise we simply clone the image as it is
-		else
-			imgEdges = img.clone();
-
-		// compute first-order derivatives along X and Y
-		cv::Mat img_dx, img_dy;
-		cv::Sobel(imgEdges, img_dx, CV_32F, 1, 0);
-		cv::Sobel(imgEdges, img_dy, CV_32F, 0, 1);
-
-		// compute gradient magnitude and angle (not used, but could also be used for thresholding)
-		cv::Mat mag, angle;
-		cv::cartToPolar(img_dx, img_dy, mag, angle);
+		// gaussian smoothing (if 'sigmaGradX10' is 0, we simply take the image as it is)
+		cv::Mat img_smoothed = scale_space.blur(sigmaGradX10/10.0);
 
 		// generate a binary image from gradient magnitude 
 		// by taking pixels whose gradient magnitude is higher than the specified threshold
-		for(int y=0; y<imgEdges.rows; y++)
-		{
-			aia::uint8* imgEdgesYthRow = imgEdges.ptr<aia::uint8>(y); 
-			float* magYthRow = mag.ptr<float>(y); 
-
-			for(int x=0; x<imgEdges.cols; x++)
-			{
-				if(magYthRow[x] > thresholdGrad)
-					imgEdgesYthRow[x] = 255;
-				else
-					imgEdgesYthRow[x] = 0;
-			}
-		}
+		// (first-order derivatives along X and Y, magnitude and thresholding are computed in one pass,
+		//  the gradient angle could also be used for thresholding, see aia::sobelGradient)
+		cv::Mat imgEdges = aia::sobelEdges(img_smoothed, thresholdGrad, 1.0);
 
 		cv::imshow("Edge detection (gradient)", imgEdges);
 	}
@@ -82,16 +58,8 @@ namespace aia
 	{
 		cv::Mat imgEdges;              // we will store here the binary image after edge detection to be displayed
 
-		// calculate gaussian kernel size so that 99% of data are under the gaussian 
-		int n = 6* (sigmaLoGX10/10.0);
-		if(n % 2 == 0)
-			n++;
-		// if 'sigmaLoGX10' is valid, we apply gaussian smoothing
-		if(sigmaLoGX10 > 0)
-			cv::GaussianBlur(img, imgEdges, cv::Size(n,n), (sigmaLoGX10/10.0), (sigmaLoGX10/10.0));
-		// otherwise we simply clone the image as it is
-		else
-			imgEdges = img.clone();
+		// gaussian smoothing (if 'sigmaLoGX10' is 0, we simply take the image as it is)
+		imgEdges = scale_space.blur(sigmaLoGX10/10.0);
 
 		// create 45 degrees-rotation-invariant Laplacian kernel
 		cv::Mat laplacianKernel = (cv::Mat_<float>(3, 3) <<
@@ -106,38 +74,8 @@ namespace aia
 		cv::filter2D(imgEdges, LoGresult, CV_32F, laplacianKernel);
 
 		// zero-crossing detection with 3x3 window (i.e. we detected positive/negative patterns along 4 directions)
-		imgEdges.setTo(cv::Scalar(0));	// reset to 0s
-		for(int y=1; y<imgEdges.rows-2; y++)
-		{
-			unsigned char* img_edges_curr_row = imgEdges.ptr<unsigned char>(y);
-
-			float* LoG_curr_row = LoGresult.ptr<float>(y);
-			float* LoG_prev_row = LoGresult.ptr<float>(y-1);
-			float* LoG_next_row = LoGresult.ptr<float>(y+1);
-
-			for(int x=1; x<imgEdges.cols-2; x++)
-			{
-				// get 8 neighbors
-				float N		= LoG_prev_row[	x];
-				float NE	= LoG_prev_row[	x+1];
-				float E		= LoG_curr_row[	x+1];
-				float SE	= LoG_next_row[	x+1];
-				float S		= LoG_next_row[	x];
-				float SO	= LoG_next_row[	x-1];
-				float O		= LoG_curr_row[	x-1];
-				float NO	= LoG_prev_row[	x-1];
-
-				if( (N>0 && S<0 && fabs(N-S) >= thresholdLoG) ||
-					(S>0 && N<0 && fabs(N-S) >= thresholdLoG) ||
-					(E>0 && O<0 && fabs(E-O) >= thresholdLoG) ||
-					(O>0 && E<0 && fabs(E-O) >= thresholdLoG) ||
-					(NE>0 && SO<0 && fabs(NE-SO) >= thresholdLoG) ||
-					(SO>0 && NE<0 && fabs(NE-SO) >= thresholdLoG) ||
-					(NO>0 && SE<0 && fabs(SE-NO) >= thresholdLoG) ||
-					(SE>0 && NO<0 && fabs(SE-NO) >= thresholdLoG))
-					img_edges_curr_row[x] = 255;
-			}
-		}
+		// on the whole image except its 1-pixel border, with all 4 directions tested at once on vector lanes
+		imgEdges = aia::zeroCrossings(LoGresult, thresholdLoG);
 
 		cv::imshow("Edge detection (LoG)", imgEdges);
 	}
@@ -151,21 +89,12 @@ namespace aia
 	{
 		cv::Mat imgEdges;              // we will store here the binary image after edge detection to be displayed
 
-		// calculate gaussian kernel size so that 99% of data are under the gaussian 
-		int n = 6* (sigmaCannyX10/10.0);
-		if(n % 2 == 0)
-			n++;
-		// if 'sigmaCannyX10' is valid, we apply gaussian smoothing
-		if(sigmaCannyX10 > 0)
-			cv::GaussianBlur(img, imgEdges, cv::Size(n,n), (sigmaCannyX10/10.0), (sigmaCannyX10/10.0));
-		// otherwise we simply clone the image as it is
-		else
-			imgEdges = img.clone();
-
-		// NOTE: OpenCV Canny function does not include gaussian smoothing: that's why we must did it before calling cv::Canny
-		cv::Canny(imgEdges, imgEdges, thresholdCanny, 3*thresholdCanny);
-		//                                            /\
-		//                                            || suggested by Canny: 2 * low threshold <= high threshold <= 3 * low threshold
+		// NOTE: OpenCV Canny function does not include gaussian smoothing, whereas aia::canny does it
+		// (no smoothing if 'sigmaCannyX10' is 0) fused with gradient, non-maximum suppression and
+		// hysteresis in parallel row bands (same result as cv::Canny on the smoothed image)
+		imgEdges = canny(img, thresholdCanny, 3*thresholdCanny, sigmaCannyX10/10.0);
+		//                                  /\
+		//                                  || suggested by Canny: 2 * low threshold <= high threshold <= 3 * low threshold
 
 		cv::imshow("Edge detection (Canny)", imgEdges);
 	}
@@ -180,6 +109,7 @@ int main()
 		aia::img = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/brain_ct.jpeg", CV_LOAD_IMAGE_GRAYSCALE);
 		if(!aia::img.data)
 			throw aia::error("Cannot open image");
+		aia::scale_space.setImage(aia::img);
 
 		// show the image
 		cv::imshow("Image", aia::img);
@@ -2,6 +2,9 @@
 #include "aiaConfig.h"
 #include "ucasConfig.h"
 
+// include my project functions
+#include "functions.h"
+
 namespace aia
 {
 	// frame-by-frame cartoonification function declaration ( see definition after the main() )
@@ -53,25 +56,11 @@ cv::Mat aia::cartoonify(const cv::Mat & frame) throw (aia::error)
 	cv::Mat frame_gray;
 	cv::cvtColor(frame, frame_gray, cv::COLOR_BGR2GRAY);
 
-	// calculate first-order derivatives through convolution with Sobel filters
-	cv::Mat dx,dy;
-	cv::Sobel(frame_gray, dx, CV_32F, 1, 0);	// Sobel filter that yields x-derivative
-	cv::Sobel(frame_gray, dy, CV_32F, 0, 1);	// Sobel filter that yields y-derivative
-	//                          /\
-	//                          || derivatives can yield negative values, better to store in float
-
-	// calculate magnitude of gradient G = (dx dy)'
-	cv::Mat mag;
-	cv::magnitude(dx, dy, mag);
-
-	// 'mag' is not meant for direct visualization
-	// we need to normalize its histogram so that it can fit within the visualization range [0, 255]
-	double minV, maxV;
-	cv::minMaxLoc(mag, &minV, &maxV);	// calculate minimum and maximum intensities
-	mag = mag - minV;					// shift whole image histogram to the right, by minV
-	mag = mag * (255.0)/(maxV-minV);	// normalize whole histogram in the [0,255] range
-	mag.convertTo(mag, CV_8U);			// convert from 32F ( = float) to 8U type ( = unsigned char )
-	mag = mag*3;						// edge amplification / strengthening by a factor of '3'
+	// calculate first-order derivatives through convolution with Sobel filters,
+	// then magnitude of gradient G = (dx dy)' normalized in the [0,255] range
+	// and thresholding, all in one pass (see aia::sobelGradient)
+	// NOTE: strong edges are those whose magnitude, amplified by a factor of '3', is above 80
+	cv::Mat edges = aia::sobelEdges(frame_gray, 80 / 3.0);
 
 	// we now want to display strong edges (the ones with higher values) as dark contours 
 	// displayed on top of the color image after rasterization with Mean-Shift
@@ -80,12 +69,12 @@ cv::Mat aia::cartoonify(const cv::Mat & frame) throw (aia::error)
 	for(int y=0; y<img.rows; y++)
 	{
 		unsigned char* imgRow = img.ptr<unsigned char>(y);
-		unsigned char* magRow = mag.ptr<unsigned char>(y);
+		unsigned char* edgesRow = edges.ptr<unsigned char>(y);
 
 		for(int x=0; x<img.cols; x++)
 		{
 			// if pixel(y,x) has a high gradient magnitude
-			if(magRow[x] > 80)
+			if(edgesRow[x])
 			{
 				// set color image pixel to (0,0,0) = black
 				imgRow[3*x + 0] = 0;  // B
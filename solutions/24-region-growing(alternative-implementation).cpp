@@ -2,6 +2,9 @@
 #include "aiaConfig.h"
 #include "ucasConfig.h"
 
+// include my project functions
+#include "functions.h"
+
 namespace aia
 {
 	// utility function that rotates 'img' by step*90°
@@ -43,25 +46,10 @@ namespace aia
 
 	// utility function that calculates the per-pixel
 	// standard deviation in a ksize x ksize neighborhood
+	// (from summed-area tables, so the cost does not depend on ksize)
 	cv::Mat imstdev(const cv::Mat & img, int ksize)
 	{
-		// perform all operations with float-precision
-		cv::Mat imgF;
-		img.convertTo(imgF, CV_32F);
-
-		// create averaging kernel
-		cv::Mat kernel = cv::Mat::ones(ksize, ksize, CV_32F);
-		kernel /= ksize*ksize;
-
-		// calculate standard deviation
-		cv::Mat img_avg, img_avg_sq, img_sq_avg, img_sq, img_stdev;
-		cv::filter2D(imgF, img_avg, CV_32F, kernel);
-		cv::pow(img_avg, 2, img_avg_sq);
-		cv::pow(imgF, 2, img_sq);
-		cv::filter2D(img_sq, img_sq_avg, CV_32F, kernel);
-		cv::sqrt(img_sq_avg-img_avg_sq, img_stdev);
-
-		return img_stdev;
+		return aia::LocalStatistics(img).stdev(ksize);
 	}
 }
 
@@ -1,6 +1,7 @@
 // include aia and ucas utility functions
 #include "aiaConfig.h"
 #include "ucasConfig.h"
+#include "functions.h"
 
 // boost library for graph processing
 #include <boost/config.hpp>
@@ -139,8 +140,8 @@ int main()
 		ucas::imshow("Background histogram", ucas::imhist(Paint::img, Paint::seeds_BG));
 
 		// normalize seeds histograms -> seeds pdfs
-		std::vector<int> hist_FG = ucas::histogram_mask(Paint::img, Paint::seeds_FG);
-		std::vector<int> hist_BG = ucas::histogram_mask(Paint::img, Paint::seeds_BG);
+		std::vector<int> hist_FG = aia::histogram_mask(Paint::img, Paint::seeds_FG);
+		std::vector<int> hist_BG = aia::histogram_mask(Paint::img, Paint::seeds_BG);
 		int pixel_count_FG = 0;
 		int pixel_count_BG = 0;
 		for (int i = 0; i < L; i++)
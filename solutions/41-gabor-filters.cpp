@@ -2,6 +2,9 @@
 #include "aiaConfig.h"
 #include "ucasConfig.h"
 
+// include my project functions
+#include "functions.h"
+
 // include opencv
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
@@ -11,31 +14,54 @@ int main()
 {
 	cv::Mat img = cv::imread(std::string(EXAMPLE_IMAGES_PATH) + "/road.jpg");
 
-	cv::Mat res(img.rows, img.cols, CV_32FC3, cv::Scalar(0, 0, 0));
 	int angles = 16;
-	for (int ang_idx = 0; ang_idx < angles; ang_idx++)
-	{
-		float theta = ang_idx * ucas::PI / angles;
+	aia::GaborBank bank(cv::Size(31, 31), 2, angles, 5, 0.5);
 
-		cv::Mat kernel_re = cv::getGaborKernel(cv::Size(31, 31), 2, theta, 5, 0.5, 0);
-		cv::Mat kernel_im = cv::getGaborKernel(cv::Size(31, 31), 2, theta, 5, 0.5);
+	// filter bank in the frequency domain: the kernel spectra are computed at the first call
+	// and reused for all the following images of the same size
+	cv::Mat res, orientation;
+	bank.filter(img, res, orientation);
 
-		cv::Mat filtered_re, filtered_im;
-		cv::filter2D(img, filtered_re, CV_32FC3, kernel_re);
-		cv::filter2D(img, filtered_im, CV_32FC3, kernel_im);
-		cv::Mat filtered_mag;
-		cv::magnitude(filtered_re, filtered_im, filtered_mag);
+	// benchmark = true also runs the spatial filtering with each kernel (reference) and times
+	// both methods, with the kernel spectra already cached
+	bool benchmark = false;
+	if (benchmark)
+	{
+		ucas::Timer timer;
+		cv::Mat res_spatial(img.rows, img.cols, CV_32FC3, cv::Scalar(0, 0, 0));
+		for (int ang_idx = 0; ang_idx < angles; ang_idx++)
+		{
+			cv::Mat filtered_re, filtered_im;
+			cv::filter2D(img, filtered_re, CV_32FC3, bank.kernel(ang_idx, false));
+			cv::filter2D(img, filtered_im, CV_32FC3, bank.kernel(ang_idx, true));
+			cv::Mat filtered_mag;
+			cv::magnitude(filtered_re, filtered_im, filtered_mag);
 
-		res = cv::max(res, filtered_mag);
+			res_spatial = cv::max(res_spatial, filtered_mag);
+		}
+		float spatial_ms = timer.elapsed<float>() * 1000;
 
+		timer.restart();
+		bank.filter(img, res, orientation);
+		float cached_ms = timer.elapsed<float>() * 1000;
+		printf("%d orientations: filter2D %.1f ms, GaborBank %.1f ms, max difference %.4f\n",
+			angles, spatial_ms, cached_ms, cv::norm(res, res_spatial, cv::NORM_INF));
+	}
+
+	for (int ang_idx = 0; ang_idx < angles; ang_idx++)
+	{
+		cv::Mat kernel_re = bank.kernel(ang_idx, false);
+		cv::Mat kernel_im = bank.kernel(ang_idx, true);
 		cv::normalize(kernel_re, kernel_re, 0, 1, cv::NORM_MINMAX);
 		cv::normalize(kernel_im, kernel_im, 0, 1, cv::NORM_MINMAX);
-		cv::normalize(filtered_mag, filtered_mag, 0, 1, cv::NORM_MINMAX);
 		aia::imshow("kernel re", kernel_re, false, 6.0);
-		aia::imshow("kernel img", kernel_im, false, 6.0);
-		aia::imshow("filtered mag", filtered_mag, true);
+		aia::imshow("kernel img", kernel_im, true, 6.0);
 	}
 
+	// dominant orientation (index of the strongest filter)
+	orientation.convertTo(orientation, CV_8UC3, 255.0 / angles);
+	aia::imshow("Orientation", orientation, false, 1.0);
+
 	cv::normalize(res, res, 0, 255, cv::NORM_MINMAX);
 	res.convertTo(res, CV_8UC3);
 	aia::imshow("Result", res, true, 1.0);